@@ -0,0 +1,66 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "GrayscaleConversion.h"
+
+// convertToFlippedGrayscale against the cv::cvtColor and cv::flip pair it replaces, on sensor-sized
+// bottom-up frames: checks that the values are identical and reports the time per frame of both
+// (tests/GrayscaleConversionTest checks the values on every build)
+namespace
+{
+    template<class F>
+    double microsecondsPerRun(const int runs, F&& f)
+    {
+        f(); // warm-up, also allocates the outputs
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; ++i)
+        {
+            f();
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / runs;
+    }
+}
+
+// GrayscaleBenchmark [size] [runs]: without a size, 256, 512 and 1024 square frames
+int main(int argc, char* argv[])
+{
+    const std::vector<int> sizes = argc > 1 ? std::vector<int>{ std::stoi(argv[1]) } : std::vector<int>{ 256, 512, 1024 };
+    const int runs = argc > 2 ? std::stoi(argv[2]) : 2000;
+
+    for (const int size : sizes)
+    {
+        // Odd width too, so the scalar tail of the row kernels is covered
+        for (const int width : { size, size - 5 })
+        {
+            cv::Mat bgr(size, width, CV_8UC3);
+            cv::randu(bgr, cv::Scalar::all(0), cv::Scalar::all(256));
+            const std::span<const std::uint8_t> bytes(bgr.data, bgr.total() * bgr.elemSize());
+
+            cv::Mat gray(size, width, CV_8UC1);
+            const double kernelTime = microsecondsPerRun(runs, [&] {
+                convertToFlippedGrayscale(bytes, width, size, gray.data, gray.step);
+            });
+
+            cv::Mat converted;
+            cv::Mat reference;
+            const double openCvTime = microsecondsPerRun(runs, [&] {
+                cv::cvtColor(bgr, converted, cv::COLOR_BGR2GRAY);
+                cv::flip(converted, reference, 0);
+            });
+
+            const int mismatches = cv::countNonZero(gray != reference);
+            std::cout << width << "x" << size << ", " << grayscaleConversionKernel() << " kernel: "
+                      << kernelTime << " us/frame, cvtColor + flip: " << openCvTime << " us/frame, "
+                      << mismatches << " differing pixels" << std::endl;
+            if (mismatches != 0)
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
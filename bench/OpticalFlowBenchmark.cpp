@@ -0,0 +1,206 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "RemoteAPICbor.h"
+#include "RemoteAPIRecording.h"
+
+#include "BlockMatchFlow.h"
+#include "GrayscaleConversion.h"
+#include "OpticalFlowEngine.h"
+#include "ShiftedTexture.h"
+#include "VecMove.h"
+
+// Every optical flow engine on the window VecMove hands them (the flow disc and its margin): time per disc
+// mean, cold and with the flow predicted, and how far the result is from the expected flow.
+// On a blurred random texture moved by known sub-pixel shifts the expected flow is the shift; on frame
+// pairs of a session recorded with REMOTEAPI_RECORD (second argument) it is FarnebackFlow's cold result
+namespace
+{
+    constexpr const char* s_engines[] = { "farneback", "dis-ultrafast", "dis-fast", "dis-medium", "lk", "patch", "block", "phase" };
+
+    constexpr int s_discRadius = VecMove::getFlowDiscRadius();
+    constexpr int s_windowSize = ShiftedTexture::s_windowSize;
+
+    struct FramePair
+    {
+        cv::Mat prev;
+        cv::Mat next;
+        cv::Point2f expected;
+    };
+
+    struct Result
+    {
+        double microseconds;
+        double error;
+    };
+
+    Result run(OpticalFlowEngine& engine, const std::vector<FramePair>& pairs, const bool predicted, const int runs)
+    {
+        double error = 0.0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; ++i)
+        {
+            for (const FramePair& pair : pairs)
+            {
+                const cv::Point2f centre(pair.prev.cols * 0.5f, pair.prev.rows * 0.5f);
+                engine.reset();
+                engine.setPrediction(predicted ? std::optional<OpticalFlowEngine::Prediction>({ pair.expected, 0.5f }) : std::nullopt);
+                const cv::Point2f flow = engine.calcDiscMean(pair.prev, pair.next, centre, s_discRadius, false);
+                error += std::hypot(flow.x - pair.expected.x, flow.y - pair.expected.y);
+            }
+        }
+        const double calls = static_cast<double>(runs) * pairs.size();
+        const double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        return { microseconds / calls, error / calls };
+    }
+
+    void runEngines(const std::vector<FramePair>& pairs, const int runs)
+    {
+        for (const char* name : s_engines)
+        {
+            const std::unique_ptr<OpticalFlowEngine> engine = createOpticalFlowEngine(name);
+            const Result cold = run(*engine, pairs, false, runs);
+            const Result warm = run(*engine, pairs, true, runs);
+            std::cout << "  " << name << ": " << cold.microseconds << " us, error " << cold.error
+                      << " px; predicted: " << warm.microseconds << " us, error " << warm.error << " px" << std::endl;
+        }
+    }
+
+    // Top-down gray frame of a sim.getVisionSensorImg reply (ret: image bytes, resolution); empty if it holds none
+    cv::Mat decodeFrame(const std::span<const std::uint8_t> payload)
+    {
+        RemoteAPICborReader r(payload.data(), payload.data() + payload.size());
+        if (r.peekMajor() != RemoteAPICborReader::Map || !r.findKey("ret") || r.peekMajor() != RemoteAPICborReader::Array
+            || r.readArrayHeader() < 2 || r.peekMajor() != RemoteAPICborReader::Bytes)
+        {
+            return {};
+        }
+        const std::span<const std::uint8_t> bytes = r.readBytes();
+        if (r.peekMajor() != RemoteAPICborReader::Array || r.readArrayHeader() < 2)
+        {
+            return {};
+        }
+        const int width = static_cast<int>(r.readInt());
+        const int height = static_cast<int>(r.readInt());
+        const std::size_t pixels = static_cast<std::size_t>(width) * height;
+
+        cv::Mat frame(height, width, CV_8UC1);
+        if (bytes.size() == pixels)
+        {
+            flipGrayscale(bytes, width, height, frame.data, frame.step);
+        }
+        else if (bytes.size() == pixels * 3)
+        {
+            convertToFlippedGrayscale(bytes, width, height, frame.data, frame.step);
+        }
+        else
+        {
+            return {};
+        }
+        return frame;
+    }
+
+    // Consecutive sim.getVisionSensorImg replies of the log whose requests asked for the same window, both cut
+    // to VecMove's window at their centre (VecMove reads frame windows centred on the down vector)
+    std::vector<FramePair> loadRecordedPairs(const std::string& path)
+    {
+        const RemoteAPIRecording recording(path);
+        std::unordered_map<std::uint64_t, std::vector<std::uint8_t>> frameRequests; // id -> encoded args
+        std::vector<std::uint8_t> prevArgs;
+        cv::Mat prevFrame;
+        std::vector<FramePair> pairs;
+        for (std::size_t i = 0; i < recording.size(); ++i)
+        {
+            const RemoteAPIRecording::Entry entry = recording[i];
+            const std::uint8_t* begin = entry.payload.data();
+            const std::uint8_t* end = begin + entry.payload.size();
+            if (entry.kind == RemoteAPIRecording::Request)
+            {
+                RemoteAPICborReader call(begin, end);
+                if (call.peekMajor() != RemoteAPICborReader::Map || !call.findKey("func") || call.readText() != "sim.getVisionSensorImg")
+                {
+                    continue;
+                }
+                RemoteAPICborReader args(begin, end);
+                std::vector<std::uint8_t>& encoded = frameRequests[entry.id];
+                if (args.findKey("args"))
+                {
+                    const std::uint8_t* argsBegin = args.position();
+                    args.skip();
+                    encoded.assign(argsBegin, args.position());
+                }
+                continue;
+            }
+
+            const auto it = frameRequests.find(entry.id);
+            if (it == frameRequests.end())
+            {
+                continue;
+            }
+            const std::vector<std::uint8_t> args = std::move(it->second);
+            frameRequests.erase(it);
+            const cv::Mat frame = decodeFrame(entry.payload);
+            if (frame.cols < s_windowSize || frame.rows < s_windowSize)
+            {
+                continue;
+            }
+
+            const cv::Rect window(frame.cols / 2 - s_windowSize / 2, frame.rows / 2 - s_windowSize / 2, s_windowSize, s_windowSize);
+            if (!prevFrame.empty() && args == prevArgs && frame.size() == prevFrame.size())
+            {
+                pairs.push_back({ prevFrame(window).clone(), frame(window).clone(), {} });
+            }
+            prevFrame = frame;
+            prevArgs = args;
+        }
+
+        const std::unique_ptr<OpticalFlowEngine> reference = createOpticalFlowEngine("farneback");
+        for (FramePair& pair : pairs)
+        {
+            reference->reset();
+            const cv::Point2f centre(pair.prev.cols * 0.5f, pair.prev.rows * 0.5f);
+            pair.expected = reference->calcDiscMean(pair.prev, pair.next, centre, s_discRadius, false);
+        }
+        return pairs;
+    }
+}
+
+// OpticalFlowBenchmark [runs] [session.log]
+int main(int argc, char* argv[])
+{
+    const int runs = argc > 1 ? std::stoi(argv[1]) : 200;
+
+    const ShiftedTexture texture(1.5);
+    const cv::Mat prev = texture.frame({ 0.0f, 0.0f });
+
+    std::cout << "block SAD kernel: " << BlockMatchFlow::sadKernel() << ", " << s_windowSize << "x" << s_windowSize
+              << " window, disc radius " << s_discRadius << ", " << runs << " runs" << std::endl;
+    for (const cv::Point2f shift : { cv::Point2f(0.4f, -0.3f), cv::Point2f(2.6f, 1.7f), cv::Point2f(-6.3f, 4.8f) })
+    {
+        std::cout << "shift (" << shift.x << ", " << shift.y << ")" << std::endl;
+        runEngines({ { prev, texture.frame(shift), shift } }, runs);
+    }
+
+    if (argc > 2)
+    {
+        const std::vector<FramePair> pairs = loadRecordedPairs(argv[2]);
+        if (pairs.empty())
+        {
+            std::cerr << argv[2] << " holds no consecutive frames of the same window of at least "
+                      << s_windowSize << "x" << s_windowSize << " pixels" << std::endl;
+            return 1;
+        }
+        // A run already covers every pair, so one is enough for the timings
+        std::cout << pairs.size() << " recorded frame pairs of " << argv[2] << ", error against farneback" << std::endl;
+        runEngines(pairs, 1);
+    }
+    return 0;
+}
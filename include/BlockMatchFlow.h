@@ -0,0 +1,45 @@
+#ifndef BLOCKMATCHFLOW_H
+#define BLOCKMATCHFLOW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "OpticalFlowEngine.h"
+
+// Dominant translation of the 32x32 block around a point: exhaustive SAD search on a half-resolution
+// level, refined at full resolution and to sub-pixels by fitting parabolas to the costs. The cheapest
+// engine; the dense field is one translation of the image's central block
+class BlockMatchFlow : public OpticalFlowEngine
+{
+public:
+    void calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, bool reusePrev) override;
+
+    void reset() override;
+
+    [[nodiscard]] cv::Point2f calcDiscMean(const cv::Mat& prev, const cv::Mat& next, cv::Point2f centre, int radius, bool reusePrev) override;
+
+    // Translation of the block centred at centre (image coordinates) from prev to next
+    [[nodiscard]] cv::Point2f estimate(const cv::Mat& prev, const cv::Mat& next, cv::Point2f centre);
+
+    // Sum of absolute differences of two rows x rows blocks, width bytes per row (16 or 32), with the widest
+    // kernel this file was built for (see DRONE_AVX2; SSE2 on any x86-64). sadScalar is the reference it matches
+    [[nodiscard]] static unsigned sad(const std::uint8_t* a, std::size_t aStep, const std::uint8_t* b, std::size_t bStep, int width, int rows);
+
+    [[nodiscard]] static unsigned sadScalar(const std::uint8_t* a, std::size_t aStep, const std::uint8_t* b, std::size_t bStep, int width, int rows);
+
+    // "avx2", "sse2" or "scalar"
+    [[nodiscard]] static const char* sadKernel();
+
+    static constexpr int s_blockSize = 32;
+    // Largest displacement searched, in full-resolution pixels
+    static constexpr int s_searchRadius = 16;
+
+private:
+    static constexpr int s_refineRadius = 2;
+    static constexpr int s_margin = s_searchRadius + s_refineRadius;
+    std::vector<std::uint8_t> m_prevHalf;
+    std::vector<std::uint8_t> m_nextHalf;
+};
+
+#endif
@@ -1,22 +1,58 @@
 #ifndef CAMERAOPTICALFLOW_H
 #define CAMERAOPTICALFLOW_H
 
+#include <limits>
+#include <optional>
+
 #include <opencv2/opencv.hpp>
 #include <Drone.h>
 
+#include "OpticalFlowEngine.h"
+
 class CameraOpticalFlow
 {
 public:
-    explicit CameraOpticalFlow(const Drone& drone);
+    // Farneback unless another engine is given
+    explicit CameraOpticalFlow(const Drone& drone, std::unique_ptr<OpticalFlowEngine> engine = nullptr);
 
     void calc(int x, int y, int len);
 
+    // Keeps a handle to grayFrame as the next previous frame instead of copying it
+    void calc(FramePool::Frame grayFrame, int x, int y, int len);
+
+    // Flow inside roi only. While roi stays the same, the engine may reuse what it built for the previous frame
+    void calc(FramePool::Frame grayFrame, const cv::Rect& roi);
+
+    // Mean flow over the disc of radius around centre (frame coordinates) inside roi, as far as the engine
+    // computes it. Leaves getOpticalFlowAt as it was; zero on the first frame. The engine starts from
+    // predictedFlow if given, trusting it about as much as the last prediction turned out right, with
+    // periodic full-pyramid steps that check it
+    [[nodiscard]] cv::Point2f calcDiscMean(FramePool::Frame grayFrame, const cv::Rect& roi, cv::Point2f centre, int radius,
+                                           const std::optional<cv::Point2f>& predictedFlow = std::nullopt);
+
+    // Takes grayFrame as the previous frame without computing a flow, e.g. when the frame before it does
+    // not hold the pixels the flow needs; the engine forgets what it kept
+    void restart(FramePool::Frame grayFrame);
+
     [[nodiscard]] cv::Point2f getOpticalFlowAt(int x, int y) const;
 
+    // The engine's confidence in its last result (see OpticalFlowEngine::confidence)
+    [[nodiscard]] double getConfidence() const;
+
 private:
+    // Smallest error a prediction is trusted to, in pixels, and the share of its length added to it
+    static constexpr float s_minPredictionError = 2.0f;
+    static constexpr float s_motionPredictionError = 0.25f;
+    // Steps between full-pyramid flows that ignore the prediction
+    static constexpr int s_coldStartInterval = 30;
     const Drone* m_drone;
-    cv::Mat m_prevFrame;
+    FramePool::Frame m_prevFrame;
+    std::unique_ptr<OpticalFlowEngine> m_engine;
+    cv::Rect m_roi;
+    cv::Mat m_flowROI;
     cv::Mat m_opticalFlow;
+    float m_predictionError = std::numeric_limits<float>::infinity();
+    int m_stepsSinceColdStart = 0;
 };
 
 #endif
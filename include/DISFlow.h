@@ -0,0 +1,28 @@
+#ifndef DISFLOW_H
+#define DISFLOW_H
+
+#include "OpticalFlowEngine.h"
+
+// cv::DISOpticalFlow: much cheaper than Farneback, coarser on the faster presets
+class DISFlow : public OpticalFlowEngine
+{
+public:
+    enum class Preset
+    {
+        UltraFast,
+        Fast,
+        Medium
+    };
+
+    explicit DISFlow(Preset preset);
+
+    void calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, bool reusePrev) override;
+
+    void reset() override;
+
+private:
+    cv::Ptr<cv::DISOpticalFlow> m_dis;
+    cv::Size m_lastSize;
+};
+
+#endif
@@ -3,9 +3,13 @@
 
 #include <array>
 #include <cstdint>
+#include <span>
 #include <opencv2/opencv.hpp>
 
 #include "RemoteAPIClient.h"
+#include "RemoteAPIStream.h"
+
+#include "FramePool.h"
 
 class Drone
 {
@@ -35,8 +39,39 @@ public:
         const double focalLength;
     };
 
+    struct FrameRequest
+    {
+        RemoteAPIFuture reply;
+        cv::Rect window;
+    };
+
     constexpr static std::uint64_t s_propellersCount = 4;
 
+    enum class ForceMode
+    {
+        PerPropeller, // each propeller's orientation read and its force applied by a call of its own (batched)
+        Body          // body orientation read once, all forces computed together and applied by one scripted call
+    };
+
+    // Thrust and reaction torque of every propeller, in world coordinates
+    struct PropellerForces
+    {
+        std::array<std::array<double, 3>, s_propellersCount> thrust{};
+        std::array<std::array<double, 3>, s_propellersCount> torque{};
+    };
+
+    // All readings of one simulation step, packed by the scene helper into a single reply
+    struct SensorSnapshot
+    {
+        double simulationTime = 0.0;
+        std::array<double, 3> gyroData{};
+        std::array<double, 3> position{};
+        std::array<std::array<double, 3>, s_propellersCount> propellerOrientations{};
+        std::array<double, 3> bodyOrientation{};
+        cv::Rect window;
+        FramePool::Frame frame; // full-size greyscale frame; only the pixels inside window were read
+    };
+
     const CameraInfo cameraInfo = CameraInfo(
         CV_PI / 2,
         512,
@@ -52,24 +87,95 @@ public:
 
     [[nodiscard]] cv::Mat getGrayscaleImage() const;
 
-    [[nodiscard]] std::vector<double> getGyroData() const;
+    [[nodiscard]] RemoteAPIFuture requestGrayscaleImage() const;
+
+    [[nodiscard]] cv::Mat getGrayscaleImage(const RemoteAPIFuture& request) const;
+
+    // Fetches only the window (full-frame pixels, top-left origin), in greyscale where the sensor supports it
+    [[nodiscard]] FrameRequest requestGrayscaleImage(const cv::Rect& window) const;
+
+    // Window-sized image with the same orientation as the full frame
+    [[nodiscard]] cv::Mat getGrayscaleImage(const FrameRequest& request) const;
+
+    // Writes the window into the same window of frame, a full-size greyscale frame
+    void getGrayscaleImage(const FrameRequest& request, cv::Mat& frame) const;
+
+    [[nodiscard]] cv::Rect getFullFrame() const;
+
+    [[nodiscard]] std::array<double, 3> getGyroData() const;
+
+    [[nodiscard]] RemoteAPIFuture requestGyroData() const;
+
+    [[nodiscard]] static std::array<double, 3> getGyroData(const RemoteAPIFuture& request);
 
     [[nodiscard]] double getAltitude() const;
 
+    [[nodiscard]] RemoteAPIFuture requestAltitude() const;
+
+    [[nodiscard]] static double getAltitude(const RemoteAPIFuture& request);
+
+    // One round trip for camera window, gyro data, position and propeller orientations (empty window: full frame)
+    [[nodiscard]] SensorSnapshot readSnapshot(const cv::Rect& window = {}) const;
+
+    [[nodiscard]] RemoteAPIFuture requestSnapshot(const cv::Rect& window = {}) const;
+
+    // The image is written into frame (e.g. one from a FramePool), or into a new frame if none is given
+    [[nodiscard]] SensorSnapshot getSnapshot(const RemoteAPIFuture& request, FramePool::Frame frame = {}) const;
+
+    void addSensorSources(RemoteAPIStream& stream);
+
+    [[nodiscard]] cv::Mat getGrayscaleImage(const RemoteAPISnapshot& snapshot) const;
+
+    [[nodiscard]] std::array<double, 3> getGyroData(const RemoteAPISnapshot& snapshot) const;
+
+    [[nodiscard]] double getAltitude(const RemoteAPISnapshot& snapshot) const;
+
     void setAngularVelocities(const std::array<double, s_propellersCount>& angularVelocities);
 
     void update();
 
+    // Same as update, with the orientations of the snapshot instead of reading them
+    void update(const SensorSnapshot& snapshot);
+
+    void setForceMode(ForceMode mode);
+
+    // The propellers are rigidly attached to the body, so all rotor axes are the body's z axis
+    [[nodiscard]] PropellerForces calcPropellerForces(const std::array<double, 3>& bodyAngles) const;
+
 private:
+    struct SensorSources
+    {
+        std::size_t image;
+        std::size_t gyro;
+        std::size_t position;
+    };
+
+    [[nodiscard]] cv::Mat toGrayscaleImage(std::span<const std::uint8_t> imgBytes) const;
+
+    [[nodiscard]] static cv::Mat toGrayscaleImage(std::span<const std::uint8_t> imgBytes, cv::Size size);
+
+    // Writes into grayFrame, reallocating it only when its size or type differs
+    static void toGrayscaleImage(std::span<const std::uint8_t> imgBytes, cv::Size size, cv::Mat& grayFrame);
+
+    [[nodiscard]] static std::array<double, 3> toGyroData(RemoteAPICborReader data);
+
     static std::vector<double> rotateForce(const std::vector<double>& angles, double thrust);
 
+    void applyForces(const std::array<std::array<double, 3>, s_propellersCount>& orientations);
+
+    void applyBodyForces(const std::array<double, 3>& bodyAngles);
+
     RemoteAPIObject::sim* m_sim;
     std::int64_t m_drone;
+    std::int64_t m_body;
     std::array<std::int64_t, s_propellersCount> m_respondables;
     std::int64_t m_visionSensor;
     std::int64_t m_gyroSensorScript;
+    std::int64_t m_helperScript;
+    SensorSources m_sensorSources{};
 
     std::array<double, s_propellersCount> m_angularVelocities{};
+    ForceMode m_forceMode = ForceMode::Body;
 
     const std::array<std::int64_t, s_propellersCount> m_propellerDirections{ 1, -1, 1, -1 };
 };
@@ -0,0 +1,53 @@
+#ifndef DRONESTANDINBACKEND_H
+#define DRONESTANDINBACKEND_H
+
+#include <array>
+#include <cstdint>
+#include <numbers>
+
+#include "RemoteAPIStandIn.h"
+
+// Rigid-body quadcopter over a textured ground plane, standing in for scene/scene.ttt
+class DroneStandInBackend : public RemoteAPIStandInBackend
+{
+public:
+    DroneStandInBackend();
+
+    std::array<double, 3> position(std::int64_t handle) override;
+
+    std::array<double, 3> orientation(std::int64_t handle) override;
+
+    void addForceAndTorque(std::int64_t handle, const std::array<double, 3>& force, const std::array<double, 3>& torque) override;
+
+    void visionSensorImage(std::int64_t handle, std::vector<std::uint8_t>& rgb, std::int64_t& resX, std::int64_t& resY) override;
+
+    json callScriptFunction(const std::string& func, std::int64_t script, const json& args) override;
+
+    void startSimulation() override;
+
+    void step() override;
+
+private:
+    [[nodiscard]] static double groundTexture(double x, double y);
+
+    [[nodiscard]] json readSnapshot(const json& args);
+
+    const double m_mass = 4.5;
+    const double m_inertia = 0.05;
+    const double m_armLength = 0.15;
+    const int m_resolution = 512;
+    const double m_fov = std::numbers::pi / 2;
+
+    std::int64_t m_gyroScript;
+    std::array<std::int64_t, 4> m_propellers;
+
+    std::array<double, 3> m_position{};
+    std::array<double, 3> m_velocity{};
+    std::array<double, 3> m_angles{};
+    std::array<double, 3> m_angularVelocity{};
+    std::array<double, 3> m_force{};
+    std::array<double, 3> m_torque{};
+    std::vector<std::uint8_t> m_window;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef FARNEBACKFLOW_H
+#define FARNEBACKFLOW_H
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "OpticalFlowEngine.h"
+
+// Gunnar Farneback's dense optical flow, ported from cv::calcOpticalFlowFarneback (box-filtered;
+// tests/FarnebackFlowTest checks that both agree). Cold, it starts from zero flow at the coarsest level;
+// with a prediction set, from the predicted flow at the coarsest level its error needs, like
+// OPTFLOW_USE_INITIAL_FLOW (tests/WarmStartTest). Unlike it, the pyramid and polynomial expansion of each
+// call's second image are kept, and the next call can use them for its first image instead of rebuilding them
+class FarnebackFlow : public OpticalFlowEngine
+{
+public:
+    struct Params
+    {
+        double pyrScale = 0.5;
+        int levels = 3;
+        int winSize = 15;
+        int iterations = 3;
+        int polyN = 5;
+        double polySigma = 1.2;
+    };
+
+    FarnebackFlow();
+
+    explicit FarnebackFlow(const Params& params);
+
+    void calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, bool reusePrev) override;
+
+    void reset() override;
+
+private:
+    void expand(const cv::Mat& image, int levels, std::vector<cv::Mat>& expansions);
+
+    Params m_params;
+    cv::Size m_cachedSize;
+    std::vector<cv::Mat> m_prevExpansions; // per pyramid level, finest first
+    std::vector<cv::Mat> m_nextExpansions;
+    cv::Mat m_image;
+    cv::Mat m_blurred;
+    cv::Mat m_levelImage;
+    cv::Mat m_prevFlow;
+    cv::Mat m_levelFlow;
+    cv::Mat m_matrices;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// A fixed set of frames allocated up front. A frame goes back to the pool when its last handle is
+// released, so the optical flow and the display can hold the same frame without copying it.
+// Not thread-safe: frames are acquired and released on the thread running the control loop
+class FramePool
+{
+public:
+    using Frame = std::shared_ptr<cv::Mat>;
+
+    FramePool(cv::Size size, int type, std::size_t count);
+
+    FramePool(const FramePool&) = delete;
+
+    FramePool& operator=(const FramePool&) = delete;
+
+    // When every frame is held, an extra one is allocated and freed with its last handle (see overflows)
+    [[nodiscard]] Frame acquire();
+
+    [[nodiscard]] std::size_t available() const;
+
+    [[nodiscard]] std::uint64_t overflows() const;
+
+private:
+    std::vector<cv::Mat> m_frames;
+    std::vector<cv::Mat*> m_free;
+    std::uint64_t m_overflows = 0;
+};
+
+#endif
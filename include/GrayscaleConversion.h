@@ -0,0 +1,18 @@
+#ifndef GRAYSCALECONVERSION_H
+#define GRAYSCALECONVERSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Sensor frames arrive bottom-up; these write them top-down in one pass, row by row into dst
+// (dstStep bytes apart). The gray values match cv::cvtColor(COLOR_BGR2GRAY) exactly.
+
+void convertToFlippedGrayscale(std::span<const std::uint8_t> bgr, int width, int height, std::uint8_t* dst, std::size_t dstStep);
+
+void flipGrayscale(std::span<const std::uint8_t> gray, int width, int height, std::uint8_t* dst, std::size_t dstStep);
+
+// "avx2", "ssse3" or "scalar": the row kernel convertToFlippedGrayscale was built with (see DRONE_AVX2, DRONE_SSSE3)
+const char* grayscaleConversionKernel();
+
+#endif
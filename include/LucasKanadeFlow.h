@@ -0,0 +1,44 @@
+#ifndef LUCASKANADEFLOW_H
+#define LUCASKANADEFLOW_H
+
+#include <vector>
+
+#include "OpticalFlowEngine.h"
+
+// Sparse pyramidal Lucas-Kanade on a regular grid, interpolated to a dense field. The cheapest dense
+// backend; the flow is smooth between grid points. Disc means track points of the disc only
+class LucasKanadeFlow : public OpticalFlowEngine
+{
+public:
+    explicit LucasKanadeFlow(int gridStep = 8);
+
+    void calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, bool reusePrev) override;
+
+    void reset() override;
+
+    [[nodiscard]] cv::Point2f calcDiscMean(const cv::Mat& prev, const cv::Mat& next, cv::Point2f centre, int radius, bool reusePrev) override;
+
+private:
+    void buildPyramids(const cv::Mat& prev, const cv::Mat& next, bool reusePrev);
+
+    // Tracks m_points into m_tracked, from the prediction if there is one
+    void track();
+
+    // Mean displacement of the points of the last track that were found
+    [[nodiscard]] cv::Point2f meanTracked() const;
+
+    static constexpr int s_winSize = 15;
+    static constexpr int s_maxLevel = 2;
+    static constexpr int s_discStep = 2;
+    int m_gridStep;
+    cv::Size m_cachedSize;
+    std::vector<cv::Mat> m_prevPyramid;
+    std::vector<cv::Mat> m_nextPyramid;
+    std::vector<cv::Point2f> m_points;
+    std::vector<cv::Point2f> m_tracked;
+    std::vector<unsigned char> m_status;
+    std::vector<float> m_errors;
+    cv::Mat m_gridFlow;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef OPTICALFLOWENGINE_H
+#define OPTICALFLOWENGINE_H
+
+#include <memory>
+#include <optional>
+#include <string_view>
+
+#include <opencv2/opencv.hpp>
+
+// Dense optical flow between two frames. Every backend fills the same output, so VecMove does not
+// depend on which one runs; they differ in cost and accuracy
+class OpticalFlowEngine
+{
+public:
+    // Flow expected between the next two frames, e.g. from the gyro, and how far off it may be
+    struct Prediction
+    {
+        cv::Point2f flow;
+        float error;
+    };
+
+    virtual ~OpticalFlowEngine() = default;
+
+    // Flow from prev to next, both 8-bit greyscale of the same size, into flow (CV_32FC2, same size).
+    // With reusePrev, prev holds the same pixels as the last call's next and may reuse what was built for it
+    virtual void calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, bool reusePrev) = 0;
+
+    // Forgets whatever was kept from the last call
+    virtual void reset() = 0;
+
+    // Mean flow from prev to next over the pixels within radius of centre (image coordinates). By default
+    // the mean of the dense field; engines that can estimate it directly only compute what the disc needs
+    [[nodiscard]] virtual cv::Point2f calcDiscMean(const cv::Mat& prev, const cv::Mat& next, cv::Point2f centre, int radius, bool reusePrev);
+
+    // How far the last result can be trusted, from 0 to 1; engines without such a measure always report 1
+    [[nodiscard]] virtual double confidence() const;
+
+    // Following calls start from the predicted flow instead of zero; coarse-to-fine engines then skip the
+    // levels its error does not need. Kept until replaced; std::nullopt goes back to cold starts
+    void setPrediction(const std::optional<Prediction>& prediction);
+
+protected:
+    [[nodiscard]] const std::optional<Prediction>& getPrediction() const;
+
+    // Pyramid levels above the finest, each scale times the size of the one below, that bring a motion
+    // of error pixels down to what one level resolves; at most maxLevels
+    [[nodiscard]] static int levelsFor(float error, double scale, int maxLevels);
+
+private:
+    // Motion a single pyramid level still converges from, in pixels of that level
+    static constexpr float s_levelReach = 1.0f;
+    cv::Mat m_discFlow;
+    std::optional<Prediction> m_prediction;
+};
+
+// "farneback", "dis-ultrafast", "dis-fast", "dis-medium", "lk", "patch", "block" or "phase"
+[[nodiscard]] std::unique_ptr<OpticalFlowEngine> createOpticalFlowEngine(std::string_view name);
+
+#endif
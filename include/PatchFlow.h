@@ -0,0 +1,32 @@
+#ifndef PATCHFLOW_H
+#define PATCHFLOW_H
+
+#include <array>
+
+#include "OpticalFlowEngine.h"
+
+// One translation for a whole patch, by coarse-to-fine Lucas-Kanade over its pixels. Disc means only read
+// the disc and a search margin around it; the dense field is a single translation of the whole image
+class PatchFlow : public OpticalFlowEngine
+{
+public:
+    void calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, bool reusePrev) override;
+
+    void reset() override;
+
+    [[nodiscard]] cv::Point2f calcDiscMean(const cv::Mat& prev, const cv::Mat& next, cv::Point2f centre, int radius, bool reusePrev) override;
+
+private:
+    // Translation of the disc at centre (image coordinates) from prev to next
+    [[nodiscard]] cv::Point2f estimate(const cv::Mat& prev, const cv::Mat& next, cv::Point2f centre, float radius);
+
+    // Largest displacement the coarsest level still converges from, in full-resolution pixels
+    static constexpr int s_searchMargin = 16;
+    static constexpr int s_levels = 3;
+    static constexpr int s_iterations = 10;
+    static constexpr float s_minUpdate = 0.01f;
+    std::array<cv::Mat, s_levels> m_prevLevels;
+    std::array<cv::Mat, s_levels> m_nextLevels;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef PHASECORRELATIONFLOW_H
+#define PHASECORRELATIONFLOW_H
+
+#include "OpticalFlowEngine.h"
+
+// Global shift of the whole image by phase correlation: the peak of the inverse transform of the
+// normalised cross-power spectrum, Hann-windowed. Costs O(N log N) in the image size whatever its texture;
+// the dense field is that one shift. confidence() is the peak's share of the correlation energy
+class PhaseCorrelationFlow : public OpticalFlowEngine
+{
+public:
+    void calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, bool reusePrev) override;
+
+    void reset() override;
+
+    [[nodiscard]] cv::Point2f calcDiscMean(const cv::Mat& prev, const cv::Mat& next, cv::Point2f centre, int radius, bool reusePrev) override;
+
+    [[nodiscard]] double confidence() const override;
+
+    // Shift of next against prev; with reusePrev, prev's spectrum is the last call's next spectrum
+    [[nodiscard]] cv::Point2f estimate(const cv::Mat& prev, const cv::Mat& next, bool reusePrev);
+
+private:
+    // Hann-windowed, zero-padded transform of image into spectrum
+    void transform(const cv::Mat& image, cv::Mat& spectrum);
+
+    cv::Size m_size;
+    cv::Size m_dftSize;
+    cv::Mat m_window;
+    cv::Mat m_padded;
+    cv::Mat m_prevSpectrum;
+    cv::Mat m_nextSpectrum;
+    cv::Mat m_crossPower;
+    cv::Mat m_correlation;
+    bool m_hasNextSpectrum = false;
+    double m_confidence = 0.0;
+};
+
+#endif
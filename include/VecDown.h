@@ -10,14 +10,16 @@ public:
 
     void calc();
 
+    void calc(const std::array<double, 3>& gyroData);
+
     [[nodiscard]] cv::Point2f getVecDown() const;
 
     [[nodiscard]] cv::Point2f getVecDownDisplacement() const;
 
-private:
-  	[[nodiscard]] cv::Vec3d calcVecDown3d() const;
+    [[nodiscard]] cv::Point2f calcVecDownProjection(const std::array<double, 3>& gyroData) const;
 
-    [[nodiscard]] cv::Point2f calcVecDownProjection() const;
+private:
+  	[[nodiscard]] static cv::Vec3d calcVecDown3d(const std::array<double, 3>& gyroData);
 
     const Drone* m_drone;
     cv::Point2f m_vecDown;
@@ -1,6 +1,10 @@
 #ifndef VECMOVE_H
 #define VECMOVE_H
 
+#include <optional>
+
+#include "RemoteAPITask.h"
+
 #include "Drone.h"
 #include "VecDown.h"
 #include "CameraOpticalFlow.h"
@@ -8,21 +12,84 @@
 class VecMove
 {
 public:
-    explicit VecMove(const Drone& drone);
+    explicit VecMove(const Drone& drone, std::unique_ptr<OpticalFlowEngine> flowEngine = nullptr);
 
     void calc();
 
+    // Same as calc, but suspends the calling task while the sensor reads are on the wire.
+    // If gyro data or frame miss the deadline, the previous vector is kept and isStale() is true; so is it
+    // when the previous frame does not hold the pixels the optical flow needs
+    [[nodiscard]] RemoteAPITask calcAsync(RemoteAPIClock::time_point deadline = RemoteAPIClock::time_point::max());
+
+    // Same, from a snapshot read with getFrameWindow(); only fetches the full frame if the down vector left that window
+    [[nodiscard]] RemoteAPITask calcAsync(Drone::SensorSnapshot snapshot, RemoteAPIClock::time_point deadline = RemoteAPIClock::time_point::max());
+
+    [[nodiscard]] cv::Rect getFrameWindow() const;
+
+    // A frame from the pool to read the next snapshot into
+    [[nodiscard]] FramePool::Frame acquireFrame();
+
+    // Frame of the last step, shared with the optical flow; only the pixels inside getFrameReadWindow() are current
+    [[nodiscard]] FramePool::Frame getFrame() const;
+
+    [[nodiscard]] cv::Rect getFrameReadWindow() const;
+
     [[nodiscard]] cv::Point2f getVecMove() const;
 
+    [[nodiscard]] bool hasVecMove() const;
+
+    [[nodiscard]] bool isStale() const;
+
+    // Confidence of the optical flow engine in the last step's flow, from 0 to 1
+    [[nodiscard]] double getFlowConfidence() const;
+
+    // Side of the square window the optical flow engine is handed: the flow pixels around the down vector
+    // plus the slack that keeps it while the down vector moves
+    [[nodiscard]] static constexpr int getFlowWindowSize()
+    {
+        return 2 * (s_calcFlowPixels + s_flowWindowMargin) + 1;
+    }
+
+    // Radius of the disc around the down vector whose mean flow is accounted
+    [[nodiscard]] static constexpr int getFlowDiscRadius()
+    {
+        return s_accountFlowPixels;
+    }
+
 private:
+    void calc(const std::array<double, 3>& gyroData, const RemoteAPIFuture& altitudeRequest);
+
+    // None when the previous frame lacks the pixels around the down vector
+    [[nodiscard]] std::optional<cv::Point2f> calcMeanOpticalFlow(const std::array<double, 3>& gyroData);
+
+    // Pixels around the projected down vector that the optical flow reads, plus margin
+    [[nodiscard]] cv::Rect calcFlowWindow(const std::array<double, 3>& gyroData, int margin) const;
+
+    [[nodiscard]] bool coversFlowWindow(const cv::Rect& window, const std::array<double, 3>& gyroData) const;
+
+    void storeFrame(FramePool::Frame frame, const cv::Rect& window, const std::array<double, 3>& gyroData);
+
     static constexpr int s_accountFlowPixels = 10;
     static constexpr int s_calcFlowPixels = 50;
+    static constexpr int s_frameWindowMargin = 32;
+    // Slack of the optical flow window, which is kept while the down vector stays inside it
+    static constexpr int s_flowWindowMargin = 8;
+    // Current and previous frame, one being read and one held by the display
+    static constexpr std::size_t s_poolFrames = 4;
     static constexpr double s_noFlowBalanceVecMultiplier = 1.0f;
     const Drone* m_drone;
+    FramePool m_framePool; // outlives the handles held by the members below
     VecDown m_vecDown;
     CameraOpticalFlow m_cameraOpticalFlow;
+    cv::Rect m_frameWindow;
+    cv::Rect m_frameReadWindow;
+    cv::Rect m_prevFrameReadWindow;
+    cv::Rect m_flowWindow;
+    FramePool::Frame m_frame;
     cv::Point2f m_vecMove;
+    cv::Point2f m_flowTranslation; // part of the last step's flow the rotation does not explain
     bool m_hasPrev = false;
+    bool m_isStale = false;
 };
 
 #endif
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include <jsoncons/json.hpp>
+
+using namespace jsoncons;
+
+class RemoteAPICborReader
+{ // forward-only walker over an encoded CBOR item; does not allocate
+public:
+    enum Major { UInt = 0, NegInt = 1, Bytes = 2, Text = 3, Array = 4, Map = 5, Tag = 6, Simple = 7 };
+
+    RemoteAPICborReader(const uint8_t *begin, const uint8_t *end);
+
+    bool atEnd() const;
+    const uint8_t * position() const;
+    int peekMajor() const; // tags are skipped
+    void skip(); // skips one complete item
+    uint64_t readArrayHeader(); // returns element count; throws for indefinite length
+    uint64_t readMapHeader(); // returns pair count; throws for indefinite length
+    bool findKey(std::string_view key); // reads a map header and moves to the value of key
+    std::span<const uint8_t> readBytes();
+    std::string_view readText();
+    double readDouble();
+    int64_t readInt();
+    bool readBool();
+    bool readNull(); // consumes null/undefined and returns true, otherwise leaves the item
+    template<class T> T read(); // typed, see RemoteAPICborDecode
+
+private:
+    void skipTags();
+    uint8_t readHeader(uint64_t &arg, bool &indefinite);
+    void need(size_t n) const;
+    const uint8_t *p;
+    const uint8_t *end;
+};
+
+template<class T, class = void>
+struct RemoteAPICborDecode; // reads a T straight from CBOR, without a json DOM; specialize for further types
+
+template<class T>
+struct RemoteAPICborDecode<T, std::enable_if_t<std::is_floating_point_v<T>>>
+{
+    static T read(RemoteAPICborReader &r) { return T(r.readDouble()); }
+};
+
+template<class T>
+struct RemoteAPICborDecode<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+{
+    static T read(RemoteAPICborReader &r) { return T(r.readInt()); }
+};
+
+template<>
+struct RemoteAPICborDecode<bool>
+{
+    static bool read(RemoteAPICborReader &r) { return r.readBool(); }
+};
+
+template<>
+struct RemoteAPICborDecode<std::string>
+{
+    static std::string read(RemoteAPICborReader &r) { return std::string(r.readText()); }
+};
+
+template<>
+struct RemoteAPICborDecode<std::string_view>
+{ // view into the buffer
+    static std::string_view read(RemoteAPICborReader &r) { return r.readText(); }
+};
+
+template<>
+struct RemoteAPICborDecode<std::span<const uint8_t>>
+{ // view into the buffer
+    static std::span<const uint8_t> read(RemoteAPICborReader &r) { return r.readBytes(); }
+};
+
+template<class T, size_t N>
+struct RemoteAPICborDecode<std::array<T, N>>
+{
+    static std::array<T, N> read(RemoteAPICborReader &r)
+    {
+        if(r.readArrayHeader() != N)
+            throw std::runtime_error("CBOR: expected an array of " + std::to_string(N) + " values");
+        std::array<T, N> a;
+        for(auto &v : a)
+            v = RemoteAPICborDecode<T>::read(r);
+        return a;
+    }
+};
+
+template<class T>
+struct RemoteAPICborDecode<std::vector<T>>
+{
+    static std::vector<T> read(RemoteAPICborReader &r)
+    {
+        const uint64_t n = r.readArrayHeader();
+        std::vector<T> v;
+        v.reserve(size_t(n));
+        for(uint64_t i = 0; i < n; i++)
+            v.push_back(RemoteAPICborDecode<T>::read(r));
+        return v;
+    }
+};
+
+template<class... Ts>
+struct RemoteAPICborDecode<std::tuple<Ts...>>
+{ // an array with at least as many values, extra ones are skipped
+    static std::tuple<Ts...> read(RemoteAPICborReader &r)
+    {
+        const uint64_t n = r.readArrayHeader();
+        if(n < sizeof...(Ts))
+            throw std::runtime_error("CBOR: expected an array of " + std::to_string(sizeof...(Ts)) + " values");
+        std::tuple<Ts...> t{RemoteAPICborDecode<Ts>::read(r)...}; // braced init: evaluated in order
+        for(uint64_t i = sizeof...(Ts); i < n; i++)
+            r.skip();
+        return t;
+    }
+};
+
+template<class T>
+T RemoteAPICborReader::read()
+{
+    return RemoteAPICborDecode<T>::read(*this);
+}
+
+class RemoteAPICborWriter
+{ // appends CBOR to a caller-owned buffer, so that a reused buffer stops allocating once it has grown
+public:
+    explicit RemoteAPICborWriter(std::vector<uint8_t> &out_);
+
+    void writeArrayHeader(uint64_t n);
+    void writeMapHeader(uint64_t n);
+    void writeText(std::string_view s);
+    void writeBytes(std::span<const uint8_t> b);
+    void writeInt(int64_t v);
+    void writeUInt(uint64_t v);
+    void writeDouble(double v);
+    void writeBool(bool v);
+    void writeNull();
+    void write(const json &j);
+
+private:
+    void writeHeader(int major, uint64_t arg);
+    std::vector<uint8_t> *out;
+};
@@ -6,8 +6,16 @@
 #include <zmq.hpp>
 #include <jsoncons/json.hpp>
 #include <jsoncons_ext/cbor/cbor.hpp>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
 #include <functional>
+#include <memory>
+#include <stdexcept>
 #include <unordered_map>
+#include <unordered_set>
+#include "RemoteAPIReply.h"
+#include "RemoteAPIStats.h"
 
 using namespace jsoncons;
 
@@ -16,25 +24,174 @@ json bin(const uint8_t *b, int size);
 json bin(const std::string &s);
 json bin(const std::vector<uint8_t> &v);
 
+class RemoteAPIFuture;
+
 #ifdef SIM_REMOTEAPICLIENT_OBJECTS
 #include "RemoteAPIObjects.h"
 #endif // SIM_REMOTEAPICLIENT_OBJECTS
 
+class RemoteAPIClient;
+class RemoteAPIBatch;
+class RemoteAPIRecorder;
+class RemoteAPILogger;
+
+using RemoteAPIClock = std::chrono::steady_clock;
+
+class RemoteAPITimeout : public std::runtime_error
+{ // a call missed its deadline (see RemoteAPIClient::setTimeout). It stays on the wire, its late reply is dropped
+public:
+    RemoteAPITimeout(const std::string &func_, std::chrono::nanoseconds waited_);
+    std::string func;
+    std::chrono::nanoseconds waited;
+};
+
+class RemoteAPIFuture
+{ // handle to the return value of a batched or asynchronous call
+    struct State;
+
+public:
+    RemoteAPIFuture() = default;
+    bool valid() const;
+    bool ready() const;
+    void wait() const; // drives the owning batch or client until resolved; throws RemoteAPITimeout past the client's timeout
+    // false if the deadline passed first; the call is then abandoned: its late reply is dropped and get()
+    // throws. Batch calls are resolved in one go, bounded only by the client's timeout
+    bool waitUntil(RemoteAPIClock::time_point deadline) const;
+    bool waitFor(std::chrono::nanoseconds timeout) const;
+    const json & get() const; // waits, then throws on remote error
+    template<class T> T get(size_t index = 0) const; // typed, decoded from the reply without json DOM; only for asynchronous calls
+    const RemoteAPIReply & reply() const; // undecoded reply, only for asynchronous calls
+    std::chrono::nanoseconds latency() const; // from sending the request to its reply, only for asynchronous calls
+
+    // co_await support: inside a RemoteAPIScheduler task the task is suspended until the reply
+    // arrives, elsewhere (and for batch calls) the call is resolved in place
+    bool await_ready() const;
+    bool await_suspend(std::coroutine_handle<> h) const;
+    const json & await_resume() const;
+
+    struct DeadlineAwaiter
+    { // co_await future.until(deadline) yields true once resolved, false if the deadline passed first (abandoned as by waitUntil)
+        std::shared_ptr<State> state;
+        RemoteAPIClock::time_point deadline;
+        bool await_ready() const;
+        bool await_suspend(std::coroutine_handle<> h) const;
+        bool await_resume() const;
+    };
+    DeadlineAwaiter until(RemoteAPIClock::time_point deadline) const;
+
+private:
+    friend class RemoteAPIBatch;
+    friend class RemoteAPIClient;
+    friend class RemoteAPIScheduler;
+    struct State
+    {
+        bool done{false};
+        bool abandoned{false}; // deadline passed before the reply; done with err set
+        bool async{false};
+        RemoteAPIClient *client{nullptr}; // drives asynchronous calls
+        bool hasReply{false};
+        bool decoded{false};
+        RemoteAPIReply reply;
+        json ret;
+        std::string err;
+        std::chrono::nanoseconds latency{0};
+        RemoteAPICallStats *stats{nullptr}; // of the called function, for decode timing
+        const std::string *func{nullptr}; // for RemoteAPITimeout
+        std::function<void()> resolve;
+    };
+    explicit RemoteAPIFuture(std::shared_ptr<State> state_);
+    std::shared_ptr<State> state;
+};
+
+class RemoteAPIBatch
+{ // queues several calls and sends them as one request with one reply
+public:
+    explicit RemoteAPIBatch(RemoteAPIClient *client_);
+    RemoteAPIFuture call(const std::string &func, std::initializer_list<json> args);
+    RemoteAPIFuture call(const std::string &func, const json &args = json(json_array_arg));
+    void execute();
+    size_t size() const;
+
+private:
+    struct Entry
+    {
+        std::string func;
+        json args;
+        std::shared_ptr<RemoteAPIFuture::State> state;
+    };
+    static void execute(RemoteAPIClient *client, std::vector<Entry> &entries);
+    RemoteAPIClient *client;
+    std::shared_ptr<std::vector<Entry>> pending;
+};
+
 class RemoteAPIClient
 {
     using CallbackType = std::function<json(const json&)>;
 
 public:
+    struct LatencyStats
+    {
+        uint64_t calls{0};
+        std::chrono::nanoseconds total{0};
+        std::chrono::nanoseconds min{std::chrono::nanoseconds::max()};
+        std::chrono::nanoseconds max{0};
+        std::chrono::nanoseconds last{0};
+        std::chrono::nanoseconds mean() const;
+    };
+
+    // host: a host name for tcp, or "tcp://host", "ipc:///path/prefix", "inproc://name";
+    // for ipc and inproc the port is appended to the path ("ipc:///tmp/sim-23000")
     RemoteAPIClient(const std::string host = "localhost", int rpcPort = 23000, int cntPort = -1, int verbose_ = -1);
+    // shares ctx_ (which must outlive the client), so inproc endpoints bound in it are reachable
+    RemoteAPIClient(zmq::context_t &ctx_, const std::string host = "localhost", int rpcPort = 23000, int cntPort = -1, int verbose_ = -1);
     ~RemoteAPIClient();
     json call(const std::string &func, std::initializer_list<json> args);
     json call(const std::string &func, const json &args = json(json_array_arg));
+    RemoteAPIReply callRaw(const std::string &func, const json &args = json(json_array_arg));
+    // first return value decoded straight into T (e.g. std::array<double, 3>), see RemoteAPICborDecode
+    template<class T> T call(const std::string &func, std::initializer_list<json> args);
+    template<class T> T call(const std::string &func, const json &args = json(json_array_arg));
+    RemoteAPIFuture callAsync(const std::string &func, std::initializer_list<json> args);
+    RemoteAPIFuture callAsync(const std::string &func, const json &args = json(json_array_arg));
+    bool poll(bool block = false); // handles the replies that arrived (block: waits for one first); true if any was handled
+    bool pollUntil(RemoteAPIClock::time_point deadline); // same, waiting for the first one until the deadline
+    size_t pendingCount() const;
+    void setMaxInFlight(size_t n); // >1 pipelines requests
+    void setExclusive(const std::string &func, bool exclusive = true); // never pipelined with other requests (default: sim.step, sim.wait)
+    // allocations the client's own bookkeeping made (pooled requests, per-function stats); constant once warmed up.
+    // libzmq still allocates per message it sends, see tests/RemoteAPIAllocationTest for the whole count
+    size_t allocationCount() const;
+    // deadline of blocking calls and waits, counted from the call (0: none). Past it they throw RemoteAPITimeout
+    void setTimeout(std::chrono::nanoseconds timeout);
+    std::chrono::nanoseconds timeout() const;
+    // spin on the socket instead of sleeping in zmq::poll: saves the wakeup latency at the cost of a core,
+    // and makes deadlines exact (zmq::poll rounds them up to milliseconds)
+    void setBusyPoll(bool enable = true);
+    std::string rpcEndpoint() const;
+    std::string streamEndpoint() const; // where the scene publishes sensor snapshots (cntPort), see RemoteAPIStream
+    const std::string & transport() const; // "tcp", "ipc" or "inproc"
+    const LatencyStats & latencyStats() const; // of every call sent since construction or the last reset
+    void resetLatencyStats();
+    // per function: calls, bytes and encode/wire/decode histograms. Also written to the file named
+    // by the REMOTEAPI_STATS environment variable when the client is destroyed
+    const RemoteAPICallStatsMap & callStats() const;
+    void resetCallStats();
+    void writeCallStats(const std::string &path) const; // JSON for *.json, CSV otherwise
+    // appends every request and reply to a log that RemoteAPIReplay can serve; also started
+    // by the REMOTEAPI_RECORD environment variable
+    void startRecording(const std::string &path);
+    void stopRecording();
+    zmq::context_t & context();
     json getObject(const std::string &name);
     void require(const std::string &name);
+    // 1: logs every request and reply (function, sizes, latency) from a background thread, to std::cout
+    // or the file named by the REMOTEAPI_LOG environment variable; 2: also samples payloads
     void setVerbose(int level = 1);
+    void setLogPayloads(unsigned everyN, size_t maxBytes = 256); // payload of every n-th message (0: none)
     void setStepping(bool enable = true); // for backw. comp., now via sim.setStepping
     void step(bool wait = true); // for backw. comp., now via sim.step
     void registerCallback(const std::string &funcName, CallbackType callback);
+    RemoteAPIBatch batch();
 
 #ifdef SIM_REMOTEAPICLIENT_OBJECTS
     inline RemoteAPIObjects& getObject() { return remoteAPIObjects; }
@@ -43,15 +200,100 @@ private:
 #endif // SIM_REMOTEAPICLIENT_OBJECTS
 
 protected:
-    void send(json &j);
-    json recv();
+    bool recvReply(uint64_t &id, RemoteAPIReply &reply, bool block = true);
+    // waits until the deadline: time_point::min() does not wait, time_point::max() waits forever
+    bool recvReply(uint64_t &id, RemoteAPIReply &reply, RemoteAPIClock::time_point deadline);
 
 private:
+    friend class RemoteAPIBatch;
+    friend class RemoteAPIFuture;
+    friend class RemoteAPIClientPool;
+    friend class RemoteAPIScheduler;
+    struct Request
+    { // pooled: reused once neither a future nor zmq references it anymore
+        uint64_t id;
+        bool exclusive;
+        bool continuation; // next message is _*executed*_ with contArgs instead of the encoded call
+        std::string func;
+        std::vector<uint8_t> encoded; // handed to zmq without copying
+        std::atomic<int> wireRefs{0}; // zmq messages still referencing encoded
+        std::chrono::steady_clock::time_point sent;
+        json contArgs;
+        RemoteAPIFuture::State state;
+    };
     CallbackType _getFunctionPointerByName(const std::string &funcName);
+    int64_t _getBatchScript();
+    std::shared_ptr<Request> _acquireRequest();
+    void _encode(std::vector<uint8_t> &buf, std::string_view func, const json &args);
+    void _send(Request &req);
+    void _sendQueued();
+    bool _pump(RemoteAPIClock::time_point deadline);
+    bool _wait(RemoteAPIFuture::State &state, RemoteAPIClock::time_point deadline);
+    uint64_t _abandon(RemoteAPIFuture::State &state); // returns the request id, for the timeout log; 0 if already done
+    bool _waitReadable(RemoteAPIClock::time_point deadline);
+    std::string _endpoint(int port) const;
+    RemoteAPICallStats & _stats(std::string_view func);
+    void _init(const std::string &host);
+    void _setSession(const std::string &uuid_, bool owner);
     int verbose{0};
+    std::chrono::nanoseconds callTimeout{0};
+    bool busyPoll{false};
+    std::string transportName;
+    std::string address;
+    int rpcPort;
+    int cntPort;
+    LatencyStats latency;
+    RemoteAPICallStatsMap stats;
+    std::string statsPath;
+    std::unique_ptr<RemoteAPIRecorder> recorder;
+    std::unique_ptr<RemoteAPILogger> logger;
+    std::string logPath;
     std::string uuid;
+    bool endsSession{true};
     int VERSION;
-    zmq::context_t ctx;
+    std::vector<uint8_t> headerCbor; // uuid, ver and lang entries, encoded once
+    std::vector<uint8_t> scratch;
+    size_t allocations{0};
+    std::vector<std::shared_ptr<Request>> requestPool; // outlives the socket, which may still reference request buffers
+    std::unique_ptr<zmq::context_t> ownCtx; // null when the context is shared
+    zmq::context_t *ctx;
     zmq::socket_t rpcSocket;
     std::unordered_map<std::string, CallbackType> callbacks;
-};
\ No newline at end of file
+    int64_t batchScript{-1};
+    uint64_t nextRequestId{1};
+    size_t maxInFlight{1};
+    std::unordered_set<std::string> exclusiveFuncs{"sim.step", "sim.wait"};
+    bool exclusiveInFlight{false};
+    std::unordered_set<std::string> forbiddenFuncs; // set by RemoteAPIClientPool on connections of other threads
+    std::vector<std::shared_ptr<Request>> queued;
+    std::vector<std::shared_ptr<Request>> inFlight;
+};
+
+template<class T>
+T RemoteAPIFuture::get(size_t index) const
+{
+    const RemoteAPIReply &r = reply();
+    const auto t0 = std::chrono::steady_clock::now();
+    T ret = r.get<T>(index);
+    if(state->stats)
+        state->stats->decode.record(std::chrono::steady_clock::now() - t0);
+    return ret;
+}
+
+template<class T>
+T RemoteAPIClient::call(const std::string &func, std::initializer_list<json> args)
+{
+    return call<T>(func, json::make_array(args));
+}
+
+template<class T>
+T RemoteAPIClient::call(const std::string &func, const json &args)
+{
+    static_assert(!std::is_same_v<T, std::string_view> && !std::is_same_v<T, std::span<const uint8_t>>,
+        "views would outlive the reply, use callRaw(...).get<T>()");
+    RemoteAPIReply reply = callRaw(func, args);
+    const auto t0 = std::chrono::steady_clock::now();
+    T ret = reply.get<T>(0);
+    _stats(func).decode.record(std::chrono::steady_clock::now() - t0);
+    return ret;
+}
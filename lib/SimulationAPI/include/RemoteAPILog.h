@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class RemoteAPILogger
+{ // tracing off the calling thread: record() copies a small fixed-size record into a ring and returns,
+  // a background thread formats and writes it. Never blocks the caller: records that do not fit are dropped
+public:
+    enum Event : uint8_t { Send = 1, Receive = 2, Timeout = 3 };
+    static constexpr size_t maxPayload = 256; // bytes of a sampled payload kept with its record
+
+    explicit RemoteAPILogger(std::ostream &os_ = std::cout, size_t capacity = 4096);
+    explicit RemoteAPILogger(const std::string &path, size_t capacity = 4096);
+    ~RemoteAPILogger(); // writes what is left
+    RemoteAPILogger(const RemoteAPILogger &) = delete;
+    RemoteAPILogger & operator=(const RemoteAPILogger &) = delete;
+
+    // keep the payload of every n-th record (0: none), at most maxBytes of it. Complete payloads are
+    // printed decoded, cut ones as hex
+    void setPayloadSampling(unsigned everyN, size_t maxBytes = maxPayload);
+    // single producer: called from the thread that owns the client
+    void record(Event event, uint64_t id, std::string_view func, size_t bytes,
+        std::chrono::nanoseconds latency = std::chrono::nanoseconds(0), std::span<const uint8_t> payload = {});
+    uint64_t dropped() const;
+
+private:
+    struct Record
+    {
+        std::chrono::steady_clock::time_point time;
+        uint64_t id;
+        uint64_t bytes;
+        std::chrono::nanoseconds latency;
+        Event event;
+        uint8_t funcLength;
+        uint16_t payloadLength;
+        char func[64];
+        uint8_t payload[maxPayload];
+    };
+    void _run();
+    void _drain();
+    void _write(const Record &r);
+    std::ofstream file;
+    std::ostream *os;
+    std::chrono::steady_clock::time_point start;
+    unsigned payloadEvery{0};
+    size_t payloadBytes{maxPayload};
+    uint64_t sampleCounter{0};
+    std::vector<Record> ring; // single producer/single consumer, one slot kept free
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+    std::atomic<uint64_t> droppedCount{0};
+    std::atomic<bool> stopping{false};
+    std::thread writer;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <thread>
+#include "RemoteAPIClient.h"
+
+struct RemoteAPIPoolConnections;
+
+class RemoteAPIClientPool
+{ // one connection per calling thread, all in the same session (uuid) and zmq context, so inproc
+  // endpoints work too. A RemoteAPIClient itself is not thread-safe; the pool is, as long as each
+  // thread only uses the connection it got from client(). A thread's connection closes when it calls
+  // release() or when it exits, whichever comes first
+public:
+    // the constructing thread is the stepping thread: only its connection may call the functions
+    // that advance or configure stepping (sim.step, sim.setStepping, sim.wait), which keeps them in order
+    RemoteAPIClientPool(const std::string host = "localhost", int rpcPort = 23000, int cntPort = -1, int verbose_ = -1);
+    ~RemoteAPIClientPool();
+    RemoteAPIClientPool(const RemoteAPIClientPool &) = delete;
+    RemoteAPIClientPool & operator=(const RemoteAPIClientPool &) = delete;
+
+    RemoteAPIClient & client(); // the calling thread's connection, opened on first use
+    void release(); // closes the calling thread's connection early; the stepping thread's one lives as long as the pool
+    size_t size() const;
+    std::thread::id steppingThread() const;
+
+private:
+    const std::string host;
+    const int rpcPort;
+    const int cntPort;
+    const int verbose;
+    const std::thread::id stepping;
+    std::unique_ptr<RemoteAPIClient> primary; // owns the session, ends it last
+    std::shared_ptr<RemoteAPIPoolConnections> connections; // also seen by exiting threads, which may outlive the pool
+};
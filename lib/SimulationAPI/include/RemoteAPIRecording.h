@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <zmq.hpp>
+
+// Log layout: "RAPILOG1", then per message {u8 kind, u64 id, u64 time ns, u32 size, payload},
+// then the index {u64 offset per message, u64 count, u64 index offset, "RAPIIDX1"}. All little-endian.
+// A log without index (e.g. the process died) is still readable, it is scanned instead.
+
+class RemoteAPIRecorder
+{ // appends the CBOR payload of every request and reply of a client, see RemoteAPIClient::startRecording
+public:
+    explicit RemoteAPIRecorder(const std::string &path);
+    ~RemoteAPIRecorder(); // writes the index
+    RemoteAPIRecorder(const RemoteAPIRecorder &) = delete;
+    RemoteAPIRecorder & operator=(const RemoteAPIRecorder &) = delete;
+
+    void record(uint8_t kind, uint64_t id, std::span<const uint8_t> payload);
+    void close();
+
+private:
+    void _write(uint64_t v, int bytes);
+    std::ofstream os;
+    uint64_t offset{0};
+    std::vector<uint64_t> index;
+    std::chrono::steady_clock::time_point start;
+};
+
+class RemoteAPIRecording
+{ // read-only, memory-mapped view of a log written by RemoteAPIRecorder
+public:
+    enum Kind : uint8_t { Request = 1, Reply = 2 };
+    struct Entry
+    {
+        Kind kind;
+        uint64_t id; // request id of the recorded client
+        std::chrono::nanoseconds time; // since recording started
+        std::span<const uint8_t> payload; // valid while the recording lives
+    };
+
+    explicit RemoteAPIRecording(const std::string &path);
+    ~RemoteAPIRecording();
+    RemoteAPIRecording(const RemoteAPIRecording &) = delete;
+    RemoteAPIRecording & operator=(const RemoteAPIRecording &) = delete;
+
+    size_t size() const;
+    Entry operator[](size_t i) const;
+
+private:
+    void _scan();
+    void _unmap();
+    const uint8_t *data{nullptr};
+    size_t length{0};
+    std::vector<uint64_t> index;
+#ifdef _WIN32
+    void *file{nullptr};
+    void *mapping{nullptr};
+#endif
+};
+
+class RemoteAPIReplay
+{ // answers a client from a recording instead of the simulator, as fast as the client asks.
+  // Calls are matched by function and arguments first, then by function only (e.g. forces computed
+  // from live input), in recorded order; continuations follow the call they belong to
+public:
+    RemoteAPIReplay(const std::string &path, zmq::context_t &ctx); // the client's context, for inproc
+    ~RemoteAPIReplay();
+    RemoteAPIReplay(const RemoteAPIReplay &) = delete;
+    RemoteAPIReplay & operator=(const RemoteAPIReplay &) = delete;
+
+    void bind(const std::string &endpoint);
+    bool serveOnce(int timeoutMs = -1); // handles at most one message; false on timeout
+    void start(); // serves on a background thread
+    void stop();
+    uint64_t unmatched() const; // calls answered with an error because the recording had nothing left for them
+
+private:
+    std::vector<uint8_t> _answer(std::span<const uint8_t> request, uint64_t liveId);
+    static int64_t _pop(std::deque<size_t> &queue, const std::vector<bool> &used);
+    RemoteAPIRecording recording;
+    zmq::socket_t socket;
+    std::map<std::string, std::deque<size_t>, std::less<>> byCall; // func + args bytes -> recorded requests
+    std::map<std::string, std::deque<size_t>, std::less<>> byFunc;
+    std::unordered_map<uint64_t, std::deque<size_t>> replies; // recorded id -> its replies in order
+    std::vector<bool> used;
+    std::unordered_map<uint64_t, uint64_t> liveToRecorded;
+    std::atomic<uint64_t> unmatchedCount{0};
+    std::thread server;
+    std::atomic<bool> stopping{false};
+};
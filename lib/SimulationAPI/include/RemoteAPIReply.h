@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <zmq.hpp>
+#include <jsoncons/json.hpp>
+#include "RemoteAPICbor.h"
+
+using namespace jsoncons;
+
+class RemoteAPIReply
+{ // owns a received message and gives views into it without building a json DOM
+public:
+    RemoteAPIReply() = default;
+    explicit RemoteAPIReply(zmq::message_t msg_);
+
+    bool contains(std::string_view key) const;
+    json decode() const; // whole reply as json DOM
+    json ret() const; // "ret" member as json DOM
+    json ret(size_t index) const; // only the given return value as json
+    std::span<const uint8_t> bytes(size_t index) const; // view into the message, valid while this reply lives
+    template<class T> T get(size_t index = 0) const { return retReader(index).read<T>(); } // typed, no json DOM
+    const uint8_t * data() const;
+    size_t size() const;
+
+    RemoteAPICborReader reader() const;
+    RemoteAPICborReader retReader(size_t index) const; // positioned on the given return value
+
+private:
+    zmq::message_t msg;
+};
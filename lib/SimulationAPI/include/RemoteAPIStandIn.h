@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zmq.hpp>
+#include <jsoncons/json.hpp>
+#include "RemoteAPICbor.h"
+
+using namespace jsoncons;
+
+class RemoteAPIStandInBackend
+{ // scene behind a RemoteAPIStandIn. The defaults give a static scene with gray frames; override to serve frames and poses
+public:
+    virtual ~RemoteAPIStandInBackend() = default;
+
+    virtual int64_t objectHandle(const std::string &path); // unknown paths get a new handle
+    virtual int64_t scriptHandle(int64_t scriptType, const std::string &path);
+    const std::string & objectPath(int64_t handle) const; // empty for unknown handles
+
+    virtual std::array<double, 3> position(int64_t handle);
+    virtual std::array<double, 3> orientation(int64_t handle); // Euler angles, as sim.getObjectOrientation
+    virtual void addForceAndTorque(int64_t handle, const std::array<double, 3> &force, const std::array<double, 3> &torque);
+    virtual void visionSensorImage(int64_t handle, std::vector<uint8_t> &rgb, int64_t &resX, int64_t &resY);
+    // visionSensorImage cut to the window at x, y (from the bottom-left, like sim.getVisionSensorImg's pos)
+    // of resX * resY pixels (0: whole frame), averaged to greyscale if gray
+    void visionSensorWindow(int64_t handle, bool gray, int64_t x, int64_t y, int64_t &resX, int64_t &resY, std::vector<uint8_t> &out);
+    virtual json callScriptFunction(const std::string &func, int64_t script, const json &args); // returns the values as array; throws if unknown
+
+    virtual void startSimulation();
+    virtual void stopSimulation();
+    virtual void step(); // advances the simulation time by timeStep()
+    double simulationTime() const;
+    double timeStep() const;
+
+protected:
+    double time{0.0};
+    double dt{0.05};
+
+private:
+    std::map<std::string, int64_t> handles;
+    std::map<int64_t, std::string> paths;
+    int64_t nextHandle{1};
+    std::vector<uint8_t> frame;
+};
+
+class RemoteAPIStandIn
+{ // speaks the remote API protocol on a ROUTER socket for the functions this project uses, so the
+  // client stack runs without CoppeliaSim. sim.step replies _*wait*_ first, like the real server
+public:
+    explicit RemoteAPIStandIn(RemoteAPIStandInBackend &backend_);
+    RemoteAPIStandIn(RemoteAPIStandInBackend &backend_, zmq::context_t &ctx_); // shares the context, required for inproc
+    ~RemoteAPIStandIn();
+    RemoteAPIStandIn(const RemoteAPIStandIn &) = delete;
+    RemoteAPIStandIn & operator=(const RemoteAPIStandIn &) = delete;
+
+    void bind(const std::string &endpoint); // e.g. "tcp://*:23000" or the client's inproc endpoint
+    void setRepeatInterval(unsigned n); // every n-th call is answered with _*repeat*_ (0: never)
+    bool serveOnce(int timeoutMs = -1); // handles at most one message; false on timeout
+    void start(); // serves on a background thread; the backend is then only used from that thread
+    void stop();
+    uint64_t requestCount() const;
+
+private:
+    void _handle(const json &req, std::string_view routingId, std::vector<uint8_t> &out);
+    json _dispatch(const std::string &func, const json &args);
+    json _batch(const json &calls);
+    const std::vector<uint8_t> & _image(const json &args, int64_t &resX, int64_t &resY);
+    std::unique_ptr<zmq::context_t> ownCtx;
+    zmq::context_t *ctx;
+    zmq::socket_t socket;
+    RemoteAPIStandInBackend *backend;
+    std::map<std::string, std::string, std::less<>> waiting; // routing id -> function resumed by _*executed*_
+    std::vector<uint8_t> image;
+    std::vector<uint8_t> out;
+    unsigned repeatInterval{0};
+    unsigned callsSinceRepeat{0};
+    std::atomic<uint64_t> requests{0};
+    std::thread server;
+    std::atomic<bool> stopping{false};
+};
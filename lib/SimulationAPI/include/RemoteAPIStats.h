@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+class RemoteAPIHistogram
+{ // HDR style log-linear buckets: ~3% resolution over the whole range, fixed size, no allocation when recording
+public:
+    void record(std::chrono::nanoseconds value);
+    uint64_t count() const;
+    std::chrono::nanoseconds min() const;
+    std::chrono::nanoseconds max() const;
+    std::chrono::nanoseconds mean() const;
+    std::chrono::nanoseconds percentile(double p) const; // p in [0, 100]; upper bound of the bucket, capped at max()
+    void reset();
+
+private:
+    static constexpr int subBucketBits = 6;
+    static constexpr uint64_t subBuckets = 1 << subBucketBits;
+    static size_t _index(uint64_t v);
+    static uint64_t _lowerBound(size_t index);
+    std::array<uint64_t, (64 - subBucketBits + 2) * subBuckets / 2> counts{};
+    uint64_t n{0};
+    uint64_t total{0};
+    uint64_t minValue{UINT64_MAX};
+    uint64_t maxValue{0};
+};
+
+struct RemoteAPICallStats
+{
+    uint64_t calls{0};
+    uint64_t bytesSent{0}; // including _*executed*_ continuations
+    uint64_t bytesReceived{0}; // including _*wait*_ and callback requests
+    uint64_t timeouts{0}; // waits that gave up at their deadline
+    RemoteAPIHistogram encode; // request to CBOR
+    RemoteAPIHistogram wire; // first send to final reply, includes server time and queueing behind pipelined calls
+    RemoteAPIHistogram decode; // reply to json, only where a DOM is built (call, RemoteAPIFuture::get)
+    void reset();
+};
+
+using RemoteAPICallStatsMap = std::map<std::string, RemoteAPICallStats, std::less<>>;
+
+void writeCallStatsCsv(std::ostream &os, const RemoteAPICallStatsMap &stats); // one row per function and phase
+void writeCallStatsJson(std::ostream &os, const RemoteAPICallStatsMap &stats);
+void writeCallStats(const std::string &path, const RemoteAPICallStatsMap &stats); // JSON for *.json, CSV otherwise
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RemoteAPIClient.h"
+
+class RemoteAPISnapshot
+{ // sensor values the scene published after one simulation step, read in place like a reply
+public:
+    explicit RemoteAPISnapshot(zmq::message_t msg_);
+    uint64_t step() const;
+    double simulationTime() const;
+    size_t sourceCount() const;
+    json values(size_t source) const; // all return values of the source
+    json value(size_t source, size_t index = 0) const;
+    std::span<const uint8_t> bytes(size_t source, size_t index = 0) const; // view into the message, valid while this snapshot lives
+    RemoteAPICborReader reader(size_t source, size_t index = 0) const; // positioned on the given return value
+    const RemoteAPIReply & message() const;
+
+private:
+    RemoteAPIReply msg;
+    uint64_t stepNumber{0};
+    double simTime{0.0};
+    size_t sources{0};
+};
+
+class RemoteAPIStream
+{ // push-based sensor data: a helper script in the scene publishes a snapshot of the added
+  // sources after each simulation step; a receiver thread keeps the latest one and a bounded queue
+public:
+    using Snapshot = std::shared_ptr<const RemoteAPISnapshot>;
+
+    explicit RemoteAPIStream(RemoteAPIClient &client_, size_t queueCapacity = 16);
+    ~RemoteAPIStream();
+    RemoteAPIStream(const RemoteAPIStream &) = delete;
+    RemoteAPIStream & operator=(const RemoteAPIStream &) = delete;
+
+    // any function callable from the scene, e.g. "sim.getVisionSensorImg"; binary: its strings arrive as byte strings.
+    // Returns the index of the source in the snapshots. Sources are fixed once started
+    size_t addSource(const std::string &func, const json &args = json(json_array_arg), bool binary = false);
+    void start(); // installs the helper script and starts receiving
+    void stop(); // removes the helper script; snapshots already received stay readable
+    bool running() const;
+
+    Snapshot latest() const; // most recent snapshot or null; lock-free, single consumer only
+    bool pop(Snapshot &snapshot); // oldest queued snapshot; single consumer only
+    uint64_t received() const;
+    uint64_t dropped() const; // did not fit the queue (still became latest) or could not be parsed
+
+private:
+    void _receive(zmq::socket_t socket);
+    void _push(Snapshot snapshot);
+    RemoteAPIClient *client;
+    json sources;
+    int64_t script{-1};
+    std::thread receiver;
+    std::atomic<bool> stopping{false};
+    // latest(): a triple buffer. The receiver fills its back slot and swaps it with the middle one,
+    // latest() swaps its front slot with the middle one when that holds a newer snapshot. Only the
+    // index changes hands, so neither side waits for the other
+    static constexpr uint8_t slotIndex = 3;
+    static constexpr uint8_t slotFresh = 4; // the middle slot holds a snapshot latest() has not taken yet
+    std::array<Snapshot, 3> slots;
+    mutable std::atomic<uint8_t> middle{1};
+    static_assert(std::atomic<uint8_t>::is_always_lock_free);
+    uint8_t back{0}; // receiver thread only
+    mutable uint8_t front{2}; // latest() only
+    std::vector<Snapshot> ring; // single producer/single consumer, one slot kept free
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+    std::atomic<uint64_t> receivedCount{0};
+    std::atomic<uint64_t> droppedCount{0};
+};
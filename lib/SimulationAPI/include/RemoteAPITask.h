@@ -0,0 +1,98 @@
+#pragma once
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "RemoteAPIClient.h"
+
+class RemoteAPITask
+{ // lazily started coroutine; run it with RemoteAPIScheduler::spawn or co_await it from another task
+public:
+    struct promise_type
+    {
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept;
+            void await_resume() noexcept {}
+        };
+
+        RemoteAPITask get_return_object();
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+    };
+
+    RemoteAPITask() = default;
+    RemoteAPITask(RemoteAPITask &&other) noexcept;
+    RemoteAPITask & operator=(RemoteAPITask &&other) noexcept;
+    RemoteAPITask(const RemoteAPITask &) = delete;
+    RemoteAPITask & operator=(const RemoteAPITask &) = delete;
+    ~RemoteAPITask();
+
+    bool done() const;
+
+    bool await_ready() const noexcept;
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    void await_resume() const;
+
+private:
+    friend class RemoteAPIScheduler;
+    explicit RemoteAPITask(std::coroutine_handle<promise_type> handle_);
+    std::coroutine_handle<promise_type> handle;
+};
+
+class RemoteAPIEvent
+{ // co_await event parks the task until another task of the same scheduler calls set()
+public:
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { waiters.push_back(h); }
+    void await_resume() const noexcept {}
+    void set(); // makes the parked tasks ready; only from a task run by a RemoteAPIScheduler
+
+private:
+    std::vector<std::coroutine_handle<>> waiters;
+};
+
+class RemoteAPIScheduler
+{ // single-threaded: interleaves tasks around the client's outstanding replies
+public:
+    struct YieldAwaiter
+    {
+        RemoteAPIScheduler *scheduler;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) const { scheduler->ready.push_back(h); }
+        void await_resume() const noexcept {}
+    };
+
+    explicit RemoteAPIScheduler(RemoteAPIClient &client_);
+    void spawn(RemoteAPITask task);
+    void run(); // until every spawned task finished; rethrows the first task exception
+    bool runOnce(bool block = true); // one round; returns false once no task is left
+    size_t taskCount() const;
+    YieldAwaiter yield(); // lets the other ready tasks run first
+    static RemoteAPIScheduler * current();
+
+private:
+    friend class RemoteAPIFuture;
+    friend class RemoteAPIEvent;
+    struct Waiter
+    {
+        std::shared_ptr<RemoteAPIFuture::State> state;
+        std::coroutine_handle<> handle;
+        RemoteAPIClock::time_point deadline;
+    };
+    void _waitFor(std::shared_ptr<RemoteAPIFuture::State> state, std::coroutine_handle<> h,
+        RemoteAPIClock::time_point deadline = RemoteAPIClock::time_point::max());
+    RemoteAPIClient *client;
+    std::vector<RemoteAPITask> tasks;
+    std::deque<std::coroutine_handle<>> ready;
+    std::vector<Waiter> waiting;
+};
@@ -2,3 +2,11 @@ std::optional<std::vector<uint8_t>> getStringSignal(std::string signalName);
 std::optional<int64_t> getInt32Signal(std::string signalName);
 std::optional<double> getFloatSignal(std::string signalName);
 json callScriptFunction(std::string functionName, int64_t scriptHandle, json inArgs = json::array());
+RemoteAPIClient * getClient();
+RemoteAPIReply getVisionSensorImgRaw(int64_t sensorHandle, std::optional<int64_t> options = {}, std::optional<double> rgbaCutOff = {}, std::optional<std::vector<int64_t>> pos = {}, std::optional<std::vector<int64_t>> size = {});
+RemoteAPIFuture getVisionSensorImgAsync(int64_t sensorHandle, std::optional<int64_t> options = {}, std::optional<double> rgbaCutOff = {}, std::optional<std::vector<int64_t>> pos = {}, std::optional<std::vector<int64_t>> size = {});
+RemoteAPIFuture getObjectPositionAsync(int64_t objectHandle, std::optional<int64_t> relativeToObjectHandle = {});
+RemoteAPIFuture getObjectOrientationAsync(int64_t objectHandle, std::optional<int64_t> relativeToObjectHandle = {});
+RemoteAPIFuture addForceAndTorqueAsync(int64_t shapeHandle, std::optional<std::vector<double>> force = {}, std::optional<std::vector<double>> torque = {});
+RemoteAPIFuture callScriptFunctionAsync(std::string functionName, int64_t scriptHandle, json inArgs = json::array());
+RemoteAPIFuture stepAsync();
\ No newline at end of file
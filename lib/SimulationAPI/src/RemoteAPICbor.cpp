@@ -0,0 +1,387 @@
+#include "RemoteAPICbor.h"
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+RemoteAPICborReader::RemoteAPICborReader(const uint8_t *begin, const uint8_t *end_)
+    : p(begin),
+      end(end_)
+{
+}
+
+bool RemoteAPICborReader::atEnd() const
+{
+    return p >= end;
+}
+
+const uint8_t * RemoteAPICborReader::position() const
+{
+    return p;
+}
+
+void RemoteAPICborReader::need(size_t n) const
+{
+    if(size_t(end - p) < n)
+        throw std::runtime_error("truncated CBOR data");
+}
+
+uint8_t RemoteAPICborReader::readHeader(uint64_t &arg, bool &indefinite)
+{
+    need(1);
+    uint8_t ib = *p++;
+    uint8_t ai = ib & 0x1f;
+    indefinite = false;
+    if(ai < 24)
+        arg = ai;
+    else if(ai >= 24 && ai <= 27)
+    {
+        size_t n = size_t(1) << (ai - 24);
+        need(n);
+        arg = 0;
+        for(size_t i = 0; i < n; i++)
+            arg = (arg << 8) | *p++;
+    }
+    else if(ai == 31)
+    {
+        indefinite = true;
+        arg = 0;
+    }
+    else
+        throw std::runtime_error("malformed CBOR header");
+    return ib >> 5;
+}
+
+void RemoteAPICborReader::skipTags()
+{
+    while(p < end && (*p >> 5) == Tag)
+    {
+        uint64_t arg;
+        bool indefinite;
+        readHeader(arg, indefinite);
+    }
+}
+
+int RemoteAPICborReader::peekMajor() const
+{
+    RemoteAPICborReader r(*this);
+    r.skipTags();
+    r.need(1);
+    return *r.p >> 5;
+}
+
+void RemoteAPICborReader::skip()
+{
+    skipTags();
+    uint64_t arg;
+    bool indefinite;
+    const uint8_t ib = *p;
+    int major = readHeader(arg, indefinite);
+    switch(major)
+    {
+    case UInt:
+    case NegInt:
+        break;
+    case Bytes:
+    case Text:
+        if(indefinite)
+        {
+            while(need(1), *p != 0xff)
+                skip();
+            p++;
+        }
+        else
+        {
+            need(arg);
+            p += arg;
+        }
+        break;
+    case Array:
+    case Map:
+        if(indefinite)
+        {
+            while(need(1), *p != 0xff)
+                skip();
+            p++;
+        }
+        else
+        {
+            uint64_t n = major == Map ? arg * 2 : arg;
+            for(uint64_t i = 0; i < n; i++)
+                skip();
+        }
+        break;
+    case Simple:
+        if(ib == 0xff)
+            throw std::runtime_error("unexpected CBOR break");
+        break;
+    }
+}
+
+uint64_t RemoteAPICborReader::readArrayHeader()
+{
+    skipTags();
+    uint64_t arg;
+    bool indefinite;
+    if(readHeader(arg, indefinite) != Array || indefinite)
+        throw std::runtime_error("expected definite-length CBOR array");
+    return arg;
+}
+
+uint64_t RemoteAPICborReader::readMapHeader()
+{
+    skipTags();
+    uint64_t arg;
+    bool indefinite;
+    if(readHeader(arg, indefinite) != Map || indefinite)
+        throw std::runtime_error("expected definite-length CBOR map");
+    return arg;
+}
+
+bool RemoteAPICborReader::findKey(std::string_view key)
+{
+    uint64_t n = readMapHeader();
+    for(uint64_t i = 0; i < n; i++)
+    {
+        if(peekMajor() == Text)
+        {
+            if(readText() == key)
+                return true;
+        }
+        else
+            skip();
+        skip(); // value
+    }
+    return false;
+}
+
+std::span<const uint8_t> RemoteAPICborReader::readBytes()
+{
+    skipTags();
+    uint64_t arg;
+    bool indefinite;
+    int major = readHeader(arg, indefinite);
+    if((major != Bytes && major != Text) || indefinite)
+        throw std::runtime_error("expected definite-length CBOR byte string");
+    need(arg);
+    std::span<const uint8_t> s(p, size_t(arg));
+    p += arg;
+    return s;
+}
+
+std::string_view RemoteAPICborReader::readText()
+{
+    skipTags();
+    uint64_t arg;
+    bool indefinite;
+    if(readHeader(arg, indefinite) != Text || indefinite)
+        throw std::runtime_error("expected definite-length CBOR text string");
+    need(arg);
+    std::string_view s(reinterpret_cast<const char *>(p), size_t(arg));
+    p += arg;
+    return s;
+}
+
+double RemoteAPICborReader::readDouble()
+{
+    skipTags();
+    need(1);
+    const uint8_t ib = *p;
+    if(ib == 0xf9)
+    { // half precision
+        need(3);
+        uint16_t h = uint16_t((p[1] << 8) | p[2]);
+        p += 3;
+        int e = (h >> 10) & 0x1f;
+        int m = h & 0x3ff;
+        double v;
+        if(e == 0)
+            v = std::ldexp(m, -24);
+        else if(e != 31)
+            v = std::ldexp(m + 1024, e - 25);
+        else
+            v = m == 0 ? INFINITY : NAN;
+        return (h & 0x8000) ? -v : v;
+    }
+    if(ib == 0xfa)
+    {
+        need(5);
+        uint32_t u = (uint32_t(p[1]) << 24) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 8) | p[4];
+        p += 5;
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+    if(ib == 0xfb)
+    {
+        need(9);
+        uint64_t u = 0;
+        for(int i = 1; i <= 8; i++)
+            u = (u << 8) | p[i];
+        p += 9;
+        double d;
+        std::memcpy(&d, &u, sizeof(d));
+        return d;
+    }
+    return double(readInt());
+}
+
+int64_t RemoteAPICborReader::readInt()
+{
+    skipTags();
+    uint64_t arg;
+    bool indefinite;
+    int major = readHeader(arg, indefinite);
+    if(major == UInt)
+        return int64_t(arg);
+    if(major == NegInt)
+        return -1 - int64_t(arg);
+    throw std::runtime_error("expected CBOR integer");
+}
+
+bool RemoteAPICborReader::readBool()
+{
+    skipTags();
+    need(1);
+    if(*p == 0xf4 || *p == 0xf5)
+        return *p++ == 0xf5;
+    throw std::runtime_error("expected CBOR boolean");
+}
+
+bool RemoteAPICborReader::readNull()
+{
+    skipTags();
+    need(1);
+    if(*p == 0xf6 || *p == 0xf7)
+    {
+        p++;
+        return true;
+    }
+    return false;
+}
+
+RemoteAPICborWriter::RemoteAPICborWriter(std::vector<uint8_t> &out_)
+    : out(&out_)
+{
+}
+
+void RemoteAPICborWriter::writeHeader(int major, uint64_t arg)
+{
+    const uint8_t mt = uint8_t(major << 5);
+    if(arg < 24)
+        out->push_back(uint8_t(mt | arg));
+    else if(arg <= 0xff)
+    {
+        out->push_back(mt | 24);
+        out->push_back(uint8_t(arg));
+    }
+    else if(arg <= 0xffff)
+    {
+        out->push_back(mt | 25);
+        for(int s = 8; s >= 0; s -= 8)
+            out->push_back(uint8_t(arg >> s));
+    }
+    else if(arg <= 0xffffffffull)
+    {
+        out->push_back(mt | 26);
+        for(int s = 24; s >= 0; s -= 8)
+            out->push_back(uint8_t(arg >> s));
+    }
+    else
+    {
+        out->push_back(mt | 27);
+        for(int s = 56; s >= 0; s -= 8)
+            out->push_back(uint8_t(arg >> s));
+    }
+}
+
+void RemoteAPICborWriter::writeArrayHeader(uint64_t n)
+{
+    writeHeader(RemoteAPICborReader::Array, n);
+}
+
+void RemoteAPICborWriter::writeMapHeader(uint64_t n)
+{
+    writeHeader(RemoteAPICborReader::Map, n);
+}
+
+void RemoteAPICborWriter::writeText(std::string_view s)
+{
+    writeHeader(RemoteAPICborReader::Text, s.size());
+    out->insert(out->end(), s.begin(), s.end());
+}
+
+void RemoteAPICborWriter::writeBytes(std::span<const uint8_t> b)
+{
+    writeHeader(RemoteAPICborReader::Bytes, b.size());
+    out->insert(out->end(), b.begin(), b.end());
+}
+
+void RemoteAPICborWriter::writeInt(int64_t v)
+{
+    if(v >= 0)
+        writeHeader(RemoteAPICborReader::UInt, uint64_t(v));
+    else
+        writeHeader(RemoteAPICborReader::NegInt, uint64_t(-1 - v));
+}
+
+void RemoteAPICborWriter::writeUInt(uint64_t v)
+{
+    writeHeader(RemoteAPICborReader::UInt, v);
+}
+
+void RemoteAPICborWriter::writeDouble(double v)
+{
+    uint64_t u;
+    std::memcpy(&u, &v, sizeof(u));
+    out->push_back(0xfb);
+    for(int s = 56; s >= 0; s -= 8)
+        out->push_back(uint8_t(u >> s));
+}
+
+void RemoteAPICborWriter::writeBool(bool v)
+{
+    out->push_back(v ? 0xf5 : 0xf4);
+}
+
+void RemoteAPICborWriter::writeNull()
+{
+    out->push_back(0xf6);
+}
+
+void RemoteAPICborWriter::write(const json &j)
+{
+    if(j.is_null())
+        writeNull();
+    else if(j.is_bool())
+        writeBool(j.as<bool>());
+    else if(j.is_int64())
+        writeInt(j.as<int64_t>());
+    else if(j.is_uint64())
+        writeUInt(j.as<uint64_t>());
+    else if(j.is_double())
+        writeDouble(j.as<double>());
+    else if(j.is_string())
+        writeText(j.as_string_view());
+    else if(j.is_byte_string())
+    {
+        auto b = j.as_byte_string_view();
+        writeBytes(std::span<const uint8_t>(b.data(), b.size()));
+    }
+    else if(j.is_array())
+    {
+        writeArrayHeader(j.size());
+        for(const auto &e : j.array_range())
+            write(e);
+    }
+    else if(j.is_object())
+    {
+        writeMapHeader(j.size());
+        for(const auto &kv : j.object_range())
+        {
+            writeText(kv.key());
+            write(kv.value());
+        }
+    }
+    else
+        writeNull();
+}
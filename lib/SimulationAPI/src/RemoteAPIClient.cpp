@@ -1,8 +1,13 @@
 #include "RemoteAPIClient.h"
+#include "RemoteAPILog.h"
+#include "RemoteAPIRecording.h"
+#include "RemoteAPITask.h"
 #include <iostream>
 #include <string>
 #include <vector>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #include <boost/format.hpp>
 #include <boost/optional.hpp>
 #include <random>
@@ -63,9 +68,300 @@ json bin(const std::vector<uint8_t> &v)
     return json{byte_string_arg, v};
 }
 
+static const char *batchHelperCode = R"lua(
+function _remoteApiBatch(calls)
+    local results = {}
+    for i, c in ipairs(calls) do
+        local f = _G
+        for part in string.gmatch(c[1], '[^%.]+') do
+            f = type(f) == 'table' and f[part] or nil
+        end
+        if type(f) ~= 'function' then
+            results[i] = {false, 'No such function: ' .. c[1]}
+        else
+            local r = table.pack(pcall(f, table.unpack(c[2], 1, c[3])))
+            if r[1] then
+                results[i] = {true, {table.unpack(r, 2, r.n)}}
+            else
+                results[i] = {false, tostring(r[2])}
+            end
+        end
+    end
+    return results
+end
+)lua";
+
+RemoteAPITimeout::RemoteAPITimeout(const std::string &func_, std::chrono::nanoseconds waited_)
+    : std::runtime_error((boost::format("%s timed out after %.3f ms") % func_ % (double(waited_.count()) / 1e6)).str()),
+      func(func_),
+      waited(waited_)
+{
+}
+
+RemoteAPIFuture::RemoteAPIFuture(std::shared_ptr<State> state_)
+    : state(std::move(state_))
+{
+}
+
+bool RemoteAPIFuture::valid() const
+{
+    return state != nullptr;
+}
+
+bool RemoteAPIFuture::ready() const
+{
+    return state && state->done;
+}
+
+void RemoteAPIFuture::wait() const
+{
+    if(!state)
+        throw std::runtime_error("RemoteAPIFuture has no associated call");
+    if(!state->done)
+    {
+        if(state->client)
+        {
+            const auto t0 = RemoteAPIClock::now();
+            const auto timeout = state->client->callTimeout;
+            if(!state->client->_wait(*state, timeout.count() > 0 ? t0 + timeout : RemoteAPIClock::time_point::max()))
+            {
+                const auto waited = RemoteAPIClock::now() - t0;
+                const uint64_t id = state->client->_abandon(*state);
+                if(state->stats)
+                    state->stats->timeouts++;
+                if(state->client->logger)
+                    state->client->logger->record(RemoteAPILogger::Timeout, id, state->func ? *state->func : std::string_view(), 0, waited);
+                throw RemoteAPITimeout(state->func ? *state->func : std::string(), waited);
+            }
+        }
+        else if(state->resolve)
+            state->resolve();
+    }
+    if(!state->done)
+        throw std::runtime_error("RemoteAPIFuture was never resolved (batch or client discarded before execution)");
+}
+
+bool RemoteAPIFuture::waitUntil(RemoteAPIClock::time_point deadline) const
+{
+    if(!state || state->done || !state->client)
+    {
+        wait();
+        return true;
+    }
+    if(state->client->_wait(*state, deadline))
+        return true;
+    state->client->_abandon(*state);
+    if(state->stats)
+        state->stats->timeouts++;
+    return false;
+}
+
+bool RemoteAPIFuture::waitFor(std::chrono::nanoseconds timeout) const
+{
+    return waitUntil(RemoteAPIClock::now() + timeout);
+}
+
+const json & RemoteAPIFuture::get() const
+{
+    wait();
+    if(!state->err.empty())
+        throw std::runtime_error(state->err.c_str());
+    if(state->hasReply && !state->decoded)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        state->ret = state->reply.ret();
+        state->decoded = true;
+        if(state->stats)
+            state->stats->decode.record(std::chrono::steady_clock::now() - t0);
+    }
+    return state->ret;
+}
+
+const RemoteAPIReply & RemoteAPIFuture::reply() const
+{
+    wait();
+    if(!state->err.empty())
+        throw std::runtime_error(state->err.c_str());
+    if(!state->hasReply)
+        throw std::runtime_error("RemoteAPIFuture::reply is only available for asynchronous calls");
+    return state->reply;
+}
+
+std::chrono::nanoseconds RemoteAPIFuture::latency() const
+{
+    wait();
+    return state->latency;
+}
+
+bool RemoteAPIFuture::await_ready() const
+{
+    return !state || state->done;
+}
+
+bool RemoteAPIFuture::await_suspend(std::coroutine_handle<> h) const
+{
+    RemoteAPIScheduler *scheduler = RemoteAPIScheduler::current();
+    if(!scheduler || !state->async)
+    {
+        wait();
+        return false;
+    }
+    scheduler->_waitFor(state, h);
+    return true;
+}
+
+const json & RemoteAPIFuture::await_resume() const
+{
+    return get();
+}
+
+RemoteAPIFuture::DeadlineAwaiter RemoteAPIFuture::until(RemoteAPIClock::time_point deadline) const
+{
+    return DeadlineAwaiter{state, deadline};
+}
+
+bool RemoteAPIFuture::DeadlineAwaiter::await_ready() const
+{
+    return !state || state->done;
+}
+
+bool RemoteAPIFuture::DeadlineAwaiter::await_suspend(std::coroutine_handle<> h) const
+{
+    RemoteAPIScheduler *scheduler = RemoteAPIScheduler::current();
+    if(!scheduler || !state->async)
+    {
+        RemoteAPIFuture(state).waitUntil(deadline);
+        return false;
+    }
+    scheduler->_waitFor(state, h, deadline);
+    return true;
+}
+
+bool RemoteAPIFuture::DeadlineAwaiter::await_resume() const
+{ // errors are left to get()
+    if(!state)
+        throw std::runtime_error("RemoteAPIFuture has no associated call");
+    return state->done && !state->abandoned;
+}
+
+RemoteAPIBatch::RemoteAPIBatch(RemoteAPIClient *client_)
+    : client(client_),
+      pending(std::make_shared<std::vector<Entry>>())
+{
+}
+
+RemoteAPIFuture RemoteAPIBatch::call(const std::string &func, std::initializer_list<json> args)
+{
+    return call(func, json::make_array(args));
+}
+
+RemoteAPIFuture RemoteAPIBatch::call(const std::string &func, const json &args)
+{
+    auto state = std::make_shared<RemoteAPIFuture::State>();
+    std::weak_ptr<std::vector<Entry>> weakPending = pending;
+    RemoteAPIClient *c = client;
+    state->resolve = [c, weakPending]()
+    {
+        if(auto p = weakPending.lock())
+            execute(c, *p);
+    };
+    pending->push_back({func, args, state});
+    return RemoteAPIFuture(state);
+}
+
+void RemoteAPIBatch::execute()
+{
+    execute(client, *pending);
+}
+
+size_t RemoteAPIBatch::size() const
+{
+    return pending->size();
+}
+
+void RemoteAPIBatch::execute(RemoteAPIClient *client, std::vector<Entry> &entries)
+{
+    if(entries.empty())
+        return;
+
+    // take ownership first, so that a reentrant get() on a future of this batch cannot resend it
+    std::vector<Entry> batch;
+    batch.swap(entries);
+
+    if(batch.size() == 1)
+    { // no need for the dispatcher round trip
+        auto &e = batch[0];
+        e.state->resolve = nullptr;
+        try
+        {
+            e.state->ret = client->call(e.func, e.args);
+        }
+        catch(const std::exception &ex)
+        {
+            e.state->err = ex.what();
+        }
+        e.state->done = true;
+        return;
+    }
+
+    json calls(json_array_arg);
+    calls.reserve(batch.size());
+    for(const auto &e : batch)
+        calls.push_back(json(json_array_arg, {json(e.func), e.args, json(e.args.size())}));
+
+    json results;
+    try
+    {
+        int64_t script = client->_getBatchScript();
+        results = client->call("sim.callScriptFunction", {"_remoteApiBatch", script, calls})[0];
+    }
+    catch(const std::exception &ex)
+    {
+        for(auto &e : batch)
+        {
+            e.state->resolve = nullptr;
+            e.state->err = ex.what();
+            e.state->done = true;
+        }
+        throw;
+    }
+
+    for(size_t i = 0; i < batch.size(); i++)
+    {
+        auto &st = *batch[i].state;
+        st.resolve = nullptr;
+        if(!results.is_array() || i >= results.size())
+            st.err = "missing batch result for " + batch[i].func;
+        else if(results[i][0].as<bool>())
+            st.ret = results[i][1].is_array() ? results[i][1] : json(json_array_arg);
+        else
+            st.err = results[i][1].as<std::string>();
+        st.done = true;
+    }
+}
+
 RemoteAPIClient::RemoteAPIClient(const std::string host, int rpcPort, int cntPort, int verbose_)
-    : rpcSocket(ctx, zmq::socket_type::req),
-      verbose(verbose_)
+    : verbose(verbose_),
+      rpcPort(rpcPort),
+      cntPort(cntPort == -1 ? rpcPort + 1 : cntPort),
+      ownCtx(std::make_unique<zmq::context_t>()),
+      ctx(ownCtx.get()),
+      rpcSocket(*ctx, zmq::socket_type::dealer)
+{
+    _init(host);
+}
+
+RemoteAPIClient::RemoteAPIClient(zmq::context_t &ctx_, const std::string host, int rpcPort, int cntPort, int verbose_)
+    : verbose(verbose_),
+      rpcPort(rpcPort),
+      cntPort(cntPort == -1 ? rpcPort + 1 : cntPort),
+      ctx(&ctx_),
+      rpcSocket(*ctx, zmq::socket_type::dealer)
+{
+    _init(host);
+}
+
+void RemoteAPIClient::_init(const std::string &host)
 {
     if(verbose == -1)
     {
@@ -74,21 +370,38 @@ RemoteAPIClient::RemoteAPIClient(const std::string host, int rpcPort, int cntPor
         else
             verbose = 0;
     }
+    if(const char* logStr = std::getenv("REMOTEAPI_LOG"))
+        logPath = logStr;
+    setVerbose(verbose);
+    if(const char* statsStr = std::getenv("REMOTEAPI_STATS"))
+        statsPath = statsStr;
+    if(const char* recordStr = std::getenv("REMOTEAPI_RECORD"))
+        startRecording(recordStr);
 
-    uuid = uuid::generate_uuid_v4();
     VERSION = 2;
+    _setSession(uuid::generate_uuid_v4(), true);
+
+    const size_t scheme = host.find("://");
+    transportName = scheme == std::string::npos ? "tcp" : host.substr(0, scheme);
+    address = scheme == std::string::npos ? host : host.substr(scheme + 3);
+    if(transportName != "tcp" && transportName != "ipc" && transportName != "inproc")
+        throw std::runtime_error("unsupported transport: " + transportName);
 
-    auto rpcAddr = (boost::format("tcp://%s:%d") % host % rpcPort).str();
-    rpcSocket.connect(rpcAddr);
+    rpcSocket.connect(rpcEndpoint());
 }
 
 RemoteAPIClient::~RemoteAPIClient()
 {
-    json req;
-    req["func"] = "_*end*_";
-    req["args"] = json::array();
-    send(req);
-    recv();
+    try
+    {
+        if(endsSession)
+            callRaw("_*end*_");
+        if(!statsPath.empty())
+            writeCallStats(statsPath);
+    }
+    catch(const std::exception &)
+    {
+    }
 }
 
 json RemoteAPIClient::call(const std::string &func, std::initializer_list<json> args)
@@ -96,64 +409,439 @@ json RemoteAPIClient::call(const std::string &func, std::initializer_list<json>
     return call(func, json::make_array(args));
 }
 
-json RemoteAPIClient::call(const std::string &_func, const json &_args)
+json RemoteAPIClient::call(const std::string &func, const json &args)
 { // call function with specified arguments. Is reentrant
-    std::string func(_func);
-    json args = _args;
-    json req;
-    req["func"] = func;
-    req["args"] = args;
-    send(req);
-    json resp = recv();
-
-    while (resp.contains("func"))
-    { // We have a callback or a wait:
-        if (resp["func"].as<std::string>().compare("_*wait*_")==0)
+    RemoteAPIReply reply = callRaw(func, args);
+    const auto t0 = std::chrono::steady_clock::now();
+    json ret = reply.ret();
+    _stats(func).decode.record(std::chrono::steady_clock::now() - t0);
+    return ret;
+}
+
+RemoteAPIReply RemoteAPIClient::callRaw(const std::string &func, const json &args)
+{ // same as call, but returns the undecoded reply, so large values can be viewed in place
+    RemoteAPIFuture f = callAsync(func, args);
+    f.wait();
+    if(!f.state->err.empty())
+        throw std::runtime_error(f.state->err.c_str());
+    return std::move(f.state->reply);
+}
+
+RemoteAPIFuture RemoteAPIClient::callAsync(const std::string &func, std::initializer_list<json> args)
+{
+    return callAsync(func, json::make_array(args));
+}
+
+RemoteAPIFuture RemoteAPIClient::callAsync(const std::string &func, const json &args)
+{ // queue a call and return at once; the reply is collected by poll() or when the future is waited on
+    if(!forbiddenFuncs.empty() && forbiddenFuncs.count(func))
+        throw std::runtime_error(func + " may only be called from the stepping thread of the connection pool");
+
+    std::shared_ptr<Request> req = _acquireRequest();
+    req->id = nextRequestId++;
+    req->exclusive = exclusiveFuncs.count(func) > 0;
+    req->continuation = false;
+    req->func.assign(func);
+    RemoteAPICallStats &s = _stats(func);
+    s.calls++;
+    req->state.stats = &s;
+    const auto t0 = std::chrono::steady_clock::now();
+    _encode(req->encoded, func, args);
+    s.encode.record(std::chrono::steady_clock::now() - t0);
+    if(queued.size() == queued.capacity())
+        allocations++;
+    queued.push_back(req);
+    _sendQueued();
+    return RemoteAPIFuture(std::shared_ptr<RemoteAPIFuture::State>(req, &req->state));
+}
+
+bool RemoteAPIClient::poll(bool block)
+{
+    return pollUntil(block ? RemoteAPIClock::time_point::max() : RemoteAPIClock::time_point::min());
+}
+
+bool RemoteAPIClient::pollUntil(RemoteAPIClock::time_point deadline)
+{
+    bool handled = _pump(deadline);
+    while(_pump(RemoteAPIClock::time_point::min()))
+        handled = true;
+    return handled;
+}
+
+size_t RemoteAPIClient::pendingCount() const
+{
+    return queued.size() + inFlight.size();
+}
+
+void RemoteAPIClient::setMaxInFlight(size_t n)
+{
+    maxInFlight = n < 1 ? 1 : n;
+    _sendQueued();
+}
+
+void RemoteAPIClient::setExclusive(const std::string &func, bool exclusive)
+{
+    if(exclusive)
+        exclusiveFuncs.insert(func);
+    else
+        exclusiveFuncs.erase(func);
+}
+
+size_t RemoteAPIClient::allocationCount() const
+{
+    return allocations;
+}
+
+void RemoteAPIClient::setTimeout(std::chrono::nanoseconds timeout)
+{
+    callTimeout = timeout;
+}
+
+std::chrono::nanoseconds RemoteAPIClient::timeout() const
+{
+    return callTimeout;
+}
+
+void RemoteAPIClient::setBusyPoll(bool enable)
+{
+    busyPoll = enable;
+}
+
+std::string RemoteAPIClient::rpcEndpoint() const
+{
+    return _endpoint(rpcPort);
+}
+
+std::string RemoteAPIClient::streamEndpoint() const
+{
+    return _endpoint(cntPort);
+}
+
+const std::string & RemoteAPIClient::transport() const
+{
+    return transportName;
+}
+
+const RemoteAPIClient::LatencyStats & RemoteAPIClient::latencyStats() const
+{
+    return latency;
+}
+
+void RemoteAPIClient::resetLatencyStats()
+{
+    latency = LatencyStats();
+}
+
+std::chrono::nanoseconds RemoteAPIClient::LatencyStats::mean() const
+{
+    return calls ? total / static_cast<int64_t>(calls) : std::chrono::nanoseconds(0);
+}
+
+void RemoteAPIClient::_setSession(const std::string &uuid_, bool owner)
+{ // connections sharing a uuid share the server-side session (e.g. stepping); only its owner ends it
+    uuid = uuid_;
+    endsSession = owner;
+    headerCbor.clear();
+    RemoteAPICborWriter w(headerCbor);
+    w.writeText("uuid");
+    w.writeText(uuid);
+    w.writeText("ver");
+    w.writeInt(VERSION);
+    w.writeText("lang");
+    w.writeText("c++");
+}
+
+const RemoteAPICallStatsMap & RemoteAPIClient::callStats() const
+{
+    return stats;
+}
+
+void RemoteAPIClient::resetCallStats()
+{ // entries are kept, pending calls still point to them
+    for(auto &entry : stats)
+        entry.second.reset();
+}
+
+void RemoteAPIClient::writeCallStats(const std::string &path) const
+{
+    ::writeCallStats(path, stats);
+}
+
+void RemoteAPIClient::startRecording(const std::string &path)
+{
+    recorder = std::make_unique<RemoteAPIRecorder>(path);
+}
+
+void RemoteAPIClient::stopRecording()
+{
+    recorder.reset();
+}
+
+RemoteAPICallStats & RemoteAPIClient::_stats(std::string_view func)
+{
+    auto it = stats.find(func);
+    if(it == stats.end())
+    {
+        allocations++;
+        it = stats.emplace(std::string(func), RemoteAPICallStats()).first;
+    }
+    return it->second;
+}
+
+std::string RemoteAPIClient::_endpoint(int port) const
+{
+    if(transportName == "tcp")
+        return (boost::format("tcp://%s:%d") % address % port).str();
+    return (boost::format("%s://%s-%d") % transportName % address % port).str();
+}
+
+zmq::context_t & RemoteAPIClient::context()
+{
+    return *ctx;
+}
+
+std::shared_ptr<RemoteAPIClient::Request> RemoteAPIClient::_acquireRequest()
+{ // a pooled request is free when only the pool holds it and zmq released its buffer
+    for(auto &r : requestPool)
+    {
+        if(r.use_count() == 1 && r->wireRefs.load(std::memory_order_acquire) == 0)
         {
-            func = "_*executed*_";
-            args = json::array();
-            json req2;
-            req2["func"] = func;
-            req2["args"] = args;
-            send(req2);
+            auto &st = r->state;
+            st.done = false;
+            st.hasReply = false;
+            st.decoded = false;
+            st.reply = RemoteAPIReply();
+            st.ret = json();
+            st.err.clear();
+            st.latency = std::chrono::nanoseconds(0);
+            st.stats = nullptr;
+            st.func = &r->func;
+            r->contArgs.clear(); // keeps its storage for the next _*executed*_
+            return r;
         }
-        else if (resp["func"].as<std::string>().compare("_*repeat*_")==0)
+    }
+    allocations++;
+    auto r = std::make_shared<Request>();
+    r->state.async = true;
+    r->state.client = this;
+    r->state.func = &r->func;
+    requestPool.push_back(r);
+    return r;
+}
+
+void RemoteAPIClient::_encode(std::vector<uint8_t> &buf, std::string_view func, const json &args)
+{ // {func, args, argsL} followed by the pre-encoded uuid/ver/lang entries
+    const size_t capacity = buf.capacity();
+    buf.clear();
+    RemoteAPICborWriter w(buf);
+    w.writeMapHeader(6);
+    w.writeText("func");
+    w.writeText(func);
+    w.writeText("args");
+    w.write(args);
+    w.writeText("argsL");
+    w.writeUInt(args.size());
+    buf.insert(buf.end(), headerCbor.begin(), headerCbor.end());
+    if(buf.capacity() != capacity)
+        allocations++;
+}
+
+static void releaseWireBuffer(void *, void *hint)
+{ // called by zmq, possibly from its I/O thread
+    static_cast<std::atomic<int> *>(hint)->fetch_sub(1, std::memory_order_release);
+}
+
+void RemoteAPIClient::_send(Request &req)
+{
+    std::vector<uint8_t> *data = &req.encoded;
+    if(req.continuation)
+    { // rare (wait or callback): encoded into the scratch buffer and copied
+        _encode(scratch, "_*executed*_", req.contArgs);
+        data = &scratch;
+    }
+
+    if(req.state.stats)
+        req.state.stats->bytesSent += data->size();
+    if(recorder)
+        recorder->record(RemoteAPIRecording::Request, req.id, *data);
+
+    if(logger)
+        logger->record(RemoteAPILogger::Send, req.id, req.continuation ? std::string_view("_*executed*_") : std::string_view(req.func), data->size(), std::chrono::nanoseconds(0), *data);
+
+    // the request id and the empty delimiter form the envelope that the server's REP socket echoes back
+    zmq::message_t idFrame(&req.id, sizeof(req.id));
+    rpcSocket.send(idFrame, zmq::send_flags::sndmore);
+    rpcSocket.send(zmq::message_t(), zmq::send_flags::sndmore);
+    if(req.continuation)
+        rpcSocket.send(zmq::buffer(*data), zmq::send_flags::none);
+    else
+    {
+        req.sent = std::chrono::steady_clock::now();
+        req.wireRefs.fetch_add(1, std::memory_order_relaxed);
+        zmq::message_t msg(req.encoded.data(), req.encoded.size(), &releaseWireBuffer, &req.wireRefs);
+        rpcSocket.send(msg, zmq::send_flags::none);
+    }
+}
+
+void RemoteAPIClient::_sendQueued()
+{ // functions that may yield on the server are exclusive: the server would take a pipelined request for their continuation
+    while(!queued.empty() && inFlight.size() < maxInFlight && !exclusiveInFlight)
+    {
+        auto req = queued.front();
+        if(req->exclusive && !inFlight.empty())
+            break;
+        queued.erase(queued.begin());
+        exclusiveInFlight = req->exclusive;
+        if(inFlight.size() == inFlight.capacity())
+            allocations++;
+        inFlight.push_back(req);
+        _send(*req);
+    }
+}
+
+bool RemoteAPIClient::_wait(RemoteAPIFuture::State &state, RemoteAPIClock::time_point deadline)
+{ // false if the deadline passed first
+    const bool bounded = deadline != RemoteAPIClock::time_point::max();
+    while(!state.done && (!inFlight.empty() || !queued.empty()))
+    {
+        if(!_pump(deadline) && inFlight.empty())
+            break; // nothing could be sent
+        if(bounded && !state.done && RemoteAPIClock::now() >= deadline)
+            return false;
+    }
+    return true;
+}
+
+uint64_t RemoteAPIClient::_abandon(RemoteAPIFuture::State &state)
+{ // a call past its deadline leaves the wire, so it cannot hold up the calls after it. Its late reply
+  // finds no request and is dropped. An exclusive call may still be in a _*wait*_ cycle on the server,
+  // which would take the next request for its continuation: it keeps the wire until its reply is drained
+    if(state.done)
+        return 0;
+    uint64_t id = 0;
+    const auto owns = [&state](const auto &r) { return &r->state == &state; };
+    auto it = std::find_if(inFlight.begin(), inFlight.end(), owns);
+    if(it != inFlight.end())
+    {
+        id = (*it)->id;
+        if(!(*it)->exclusive)
+            inFlight.erase(it);
+    }
+    else
+    {
+        auto q = std::find_if(queued.begin(), queued.end(), owns);
+        if(q != queued.end())
         {
-            json req2;
-            req2["func"] = func;
-            req2["args"] = args;
-            send(req2);
+            id = (*q)->id;
+            queued.erase(q);
         }
+    }
+    state.err = "call abandoned after its deadline passed";
+    state.abandoned = true;
+    state.done = true;
+    _sendQueued();
+    return id;
+}
+
+bool RemoteAPIClient::_pump(RemoteAPIClock::time_point deadline)
+{ // receives and handles at most one reply, waiting for it until the deadline. Returns false if nothing arrived
+    _sendQueued();
+    if(inFlight.empty())
+        return false;
+
+    uint64_t id;
+    RemoteAPIReply reply;
+    if(!recvReply(id, reply, deadline))
+        return false;
+    if(recorder)
+        recorder->record(RemoteAPIRecording::Reply, id, std::span<const uint8_t>(reply.data(), reply.size()));
+
+    auto it = std::find_if(inFlight.begin(), inFlight.end(), [id](const auto &r) { return r->id == id; });
+    if(logger)
+    {
+        const std::span<const uint8_t> payload(reply.data(), reply.size());
+        if(it != inFlight.end())
+            logger->record(RemoteAPILogger::Receive, id, (*it)->func, reply.size(), RemoteAPIClock::now() - (*it)->sent, payload);
         else
-        { // call a callback
-            auto funcToRun = _getFunctionPointerByName(resp["func"].as<std::string>());
-            json rep;
-            func = "_*executed*_";
-            if (funcToRun)
+            logger->record(RemoteAPILogger::Receive, id, "(abandoned)", reply.size(), std::chrono::nanoseconds(0), payload);
+    }
+    if(it == inFlight.end())
+        return true; // reply to a request nobody waits for anymore
+    auto req = *it;
+    if(req->state.stats)
+        req->state.stats->bytesReceived += reply.size();
+
+    if(reply.contains("func"))
+    { // We have a callback or a wait:
+        auto cbor = reply.reader();
+        cbor.findKey("func");
+        const std::string_view func = cbor.readText(); // into the reply, which outlives this
+        if(func == "_*wait*_")
+        { // every sim.step: no json DOM, and the empty args reuse the request's array
+            req->continuation = true;
+            if(req->contArgs.is_array())
+                req->contArgs.clear();
+            else
+                req->contArgs = json::array();
+        }
+        else if(func != "_*repeat*_")
+        { // call a callback. The request leaves the wire meanwhile, so the callback can call back into the client
+            json resp = reply.decode();
+            inFlight.erase(it);
+            const bool wasExclusive = exclusiveInFlight;
+            exclusiveInFlight = false;
+            auto funcToRun = _getFunctionPointerByName(std::string(func));
+            json args = json::array();
+            if(funcToRun)
             {
-                auto r = funcToRun(resp["args"]);
-                if (!r.is_array())
+                try
+                {
+                    auto r = funcToRun(resp["args"]);
+                    if(!r.is_array())
+                        args.push_back(r);
+                    else
+                        args = r;
+                }
+                catch(const std::exception &ex)
                 {
-                    auto arr = json::array();
-                    arr.push_back(r);
-                    args = arr;
+                    req->state.err = ex.what();
+                    req->state.done = true;
+                    throw;
                 }
-                else
-                    args = r;
             }
-            else
-                args = json::array();
-            rep["func"] = func;
-            rep["args"] = args;
-            send(rep);
+            exclusiveInFlight = wasExclusive;
+            req->continuation = true;
+            req->contArgs = args;
+            inFlight.push_back(req);
         }
-        resp = recv();
+        _send(*req);
+        return true;
     }
 
-    if (resp.contains("err"))
-        throw std::runtime_error(resp["err"].as<std::string>().c_str());
-    const auto &ret = resp["ret"];
-    return ret;
+    inFlight.erase(it);
+    if(req->exclusive)
+        exclusiveInFlight = false;
+    auto &st = req->state;
+    if(st.abandoned)
+    { // an exclusive call drained after its deadline: the future already reports the timeout
+        _sendQueued();
+        return true;
+    }
+    st.latency = std::chrono::steady_clock::now() - req->sent;
+    latency.calls++;
+    latency.total += st.latency;
+    latency.min = std::min(latency.min, st.latency);
+    latency.max = std::max(latency.max, st.latency);
+    latency.last = st.latency;
+    if(st.stats)
+        st.stats->wire.record(st.latency);
+    if(reply.contains("err"))
+        st.err = reply.decode()["err"].as<std::string>();
+    st.reply = std::move(reply);
+    st.hasReply = true;
+    st.done = true;
+    _sendQueued();
+    return true;
 }
 
 json RemoteAPIClient::getObject(const std::string &name)
@@ -169,6 +857,26 @@ void RemoteAPIClient::require(const std::string &name)
 void RemoteAPIClient::setVerbose(int level)
 {
     verbose = level;
+    if(verbose <= 0)
+    {
+        logger.reset();
+        return;
+    }
+    if(!logger)
+    {
+        if(logPath.empty())
+            logger = std::make_unique<RemoteAPILogger>();
+        else
+            logger = std::make_unique<RemoteAPILogger>(logPath);
+    }
+    logger->setPayloadSampling(verbose > 1 ? 16 : 0);
+}
+
+void RemoteAPIClient::setLogPayloads(unsigned everyN, size_t maxBytes)
+{
+    if(!logger)
+        setVerbose(1);
+    logger->setPayloadSampling(everyN, maxBytes);
 }
 
 void RemoteAPIClient::setStepping(bool enable)
@@ -181,57 +889,72 @@ void RemoteAPIClient::step(bool wait)
     call("sim.step", {wait});
 }
 
-void RemoteAPIClient::send(json &j)
+bool RemoteAPIClient::recvReply(uint64_t &id, RemoteAPIReply &reply, bool block)
 {
-    if(verbose > 0)
-        std::cout << "Sending: " << pretty_print(j) << std::endl;
+    return recvReply(id, reply, block ? RemoteAPIClock::time_point::max() : RemoteAPIClock::time_point::min());
+}
+
+bool RemoteAPIClient::_waitReadable(RemoteAPIClock::time_point deadline)
+{ // returns once the socket may be readable; false if the deadline passed
+    if(deadline == RemoteAPIClock::time_point::min())
+        return false;
+    const bool bounded = deadline != RemoteAPIClock::time_point::max();
+    if(busyPoll)
+        return !bounded || RemoteAPIClock::now() < deadline;
 
-    j["uuid"] = uuid;
-    j["ver"] = VERSION;
-    j["lang"] = "c++";
-    if (j.contains("args"))
+    std::chrono::milliseconds timeout(-1);
+    if(bounded)
     {
-        auto a = j["args"];
-        j["argsL"] = a.size();
+        const auto left = deadline - RemoteAPIClock::now();
+        if(left <= std::chrono::nanoseconds(0))
+            return false;
+        timeout = std::chrono::ceil<std::chrono::milliseconds>(left);
     }
+    zmq::pollitem_t item{rpcSocket.handle(), 0, ZMQ_POLLIN, 0};
+    zmq::poll(&item, 1, timeout);
+    return true;
+}
 
-
-    std::vector<uint8_t> data;
-    cbor::encode_cbor(j, data);
-
-    if(verbose > 1)
+bool RemoteAPIClient::recvReply(uint64_t &id, RemoteAPIReply &reply, RemoteAPIClock::time_point deadline)
+{ // the parts of a message arrive together: only the first one is waited for
+    zmq::message_t idFrame;
+    while(!rpcSocket.recv(idFrame, zmq::recv_flags::dontwait))
     {
-        std::cout << "Sending (raw):";
-        for(size_t i = 0; i < data.size(); i++)
-            std::cout << " " << std::hex << std::setw(2) << std::setfill('0') << int(data[i]);
-        std::cout << std::endl;
+        if(!_waitReadable(deadline))
+            return false;
+    }
+    id = 0;
+    if(idFrame.size() == sizeof(id))
+        std::memcpy(&id, idFrame.data(), sizeof(id));
+
+    zmq::message_t msg;
+    bool more = idFrame.more();
+    while(more)
+    { // rest of the envelope, then the payload
+        if(!rpcSocket.recv(msg))
+            throw std::runtime_error("incomplete reply");
+        more = msg.more();
     }
 
-    zmq::message_t msg(data.data(), data.size());
-    rpcSocket.send(msg, zmq::send_flags::dontwait);
+    reply = RemoteAPIReply(std::move(msg));
+    return true;
 }
 
-json RemoteAPIClient::recv()
+RemoteAPIBatch RemoteAPIClient::batch()
 {
-    zmq::message_t msg;
-    rpcSocket.recv(msg);
-
-    auto data = reinterpret_cast<const uint8_t*>(msg.data());
+    return RemoteAPIBatch(this);
+}
 
-    if(verbose > 1)
+int64_t RemoteAPIClient::_getBatchScript()
+{ // lazily installs the batch dispatcher into the sandbox script
+    if(batchScript == -1)
     {
-        std::cout << "Received (raw):";
-        for(size_t i = 0; i < msg.size(); i++)
-            std::cout << " " << std::hex << std::setw(2) << std::setfill('0') << int(data[i]);
-        std::cout << std::endl;
+        const int scripttype_sandbox = 8;
+        int64_t sandbox = call("sim.getScript", {scripttype_sandbox})[0].as<int64_t>();
+        call("sim.executeScriptString", {std::string(batchHelperCode) + "@lua", sandbox});
+        batchScript = sandbox;
     }
-
-    json j = cbor::decode_cbor<json>(data, data + msg.size());
-
-    if(verbose > 0)
-        std::cout << "Received: " << pretty_print(j) << std::endl;
-
-    return j;
+    return batchScript;
 }
 
 void RemoteAPIClient::registerCallback(const std::string &funcName, CallbackType callback)
@@ -0,0 +1,126 @@
+#include "RemoteAPILog.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+#include <jsoncons/json.hpp>
+#include <jsoncons_ext/cbor/cbor.hpp>
+
+static const char *eventNames[] = {"?", "send", "recv", "timeout"};
+
+RemoteAPILogger::RemoteAPILogger(std::ostream &os_, size_t capacity)
+    : os(&os_),
+      start(std::chrono::steady_clock::now()),
+      ring(capacity + 1)
+{
+    writer = std::thread(&RemoteAPILogger::_run, this);
+}
+
+RemoteAPILogger::RemoteAPILogger(const std::string &path, size_t capacity)
+    : file(path, std::ios::trunc),
+      os(&file),
+      start(std::chrono::steady_clock::now()),
+      ring(capacity + 1)
+{
+    if(!file)
+        throw std::runtime_error("cannot write " + path);
+    writer = std::thread(&RemoteAPILogger::_run, this);
+}
+
+RemoteAPILogger::~RemoteAPILogger()
+{
+    stopping = true;
+    writer.join();
+    _drain();
+    if(droppedCount > 0)
+        *os << "remote API log: " << droppedCount << " records dropped" << std::endl;
+    os->flush();
+}
+
+void RemoteAPILogger::setPayloadSampling(unsigned everyN, size_t maxBytes)
+{
+    payloadEvery = everyN;
+    payloadBytes = std::min(maxBytes, maxPayload);
+    sampleCounter = 0;
+}
+
+void RemoteAPILogger::record(Event event, uint64_t id, std::string_view func, size_t bytes, std::chrono::nanoseconds latency, std::span<const uint8_t> payload)
+{
+    const size_t t = tail.load(std::memory_order_relaxed);
+    const size_t next = (t + 1) % ring.size();
+    if(next == head.load(std::memory_order_acquire))
+    {
+        droppedCount++;
+        return;
+    }
+    Record &r = ring[t];
+    r.time = std::chrono::steady_clock::now();
+    r.id = id;
+    r.bytes = bytes;
+    r.latency = latency;
+    r.event = event;
+    r.funcLength = uint8_t(std::min(func.size(), sizeof(r.func)));
+    std::memcpy(r.func, func.data(), r.funcLength);
+    r.payloadLength = 0;
+    if(payloadEvery > 0 && !payload.empty() && ++sampleCounter % payloadEvery == 0)
+    {
+        r.payloadLength = uint16_t(std::min(payload.size(), payloadBytes));
+        std::memcpy(r.payload, payload.data(), r.payloadLength);
+    }
+    tail.store(next, std::memory_order_release);
+}
+
+uint64_t RemoteAPILogger::dropped() const
+{
+    return droppedCount.load(std::memory_order_relaxed);
+}
+
+void RemoteAPILogger::_run()
+{ // polls instead of being woken, so that record() never makes a system call
+    while(!stopping.load(std::memory_order_relaxed))
+    {
+        _drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+void RemoteAPILogger::_drain()
+{
+    bool wrote = false;
+    for(size_t h = head.load(std::memory_order_relaxed); h != tail.load(std::memory_order_acquire); h = (h + 1) % ring.size())
+    {
+        _write(ring[h]);
+        head.store((h + 1) % ring.size(), std::memory_order_release);
+        wrote = true;
+    }
+    if(wrote)
+        os->flush();
+}
+
+void RemoteAPILogger::_write(const Record &r)
+{
+    const auto t = std::chrono::duration_cast<std::chrono::microseconds>(r.time - start);
+    *os << std::dec << std::setw(12) << t.count() << " us " << std::setw(7) << std::left << eventNames[r.event < 4 ? r.event : 0] << std::right
+        << " #" << r.id << ' ' << std::string_view(r.func, r.funcLength) << ' ' << r.bytes << " B";
+    if(r.latency.count() > 0)
+        *os << ' ' << double(r.latency.count()) / 1e3 << " us";
+    *os << '\n';
+    if(r.payloadLength == 0)
+        return;
+
+    if(r.payloadLength == r.bytes)
+    {
+        try
+        {
+            *os << "    " << jsoncons::pretty_print(jsoncons::cbor::decode_cbor<jsoncons::json>(r.payload, r.payload + r.payloadLength)) << '\n';
+            return;
+        }
+        catch(const std::exception &)
+        {
+        }
+    }
+    *os << "   ";
+    for(size_t i = 0; i < r.payloadLength; i++)
+        *os << ' ' << std::hex << std::setw(2) << std::setfill('0') << int(r.payload[i]) << std::setfill(' ');
+    *os << std::dec << (r.payloadLength < r.bytes ? " ...\n" : "\n");
+}
@@ -0,0 +1,101 @@
+#include "RemoteAPIPool.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <vector>
+
+static const char *steppingFuncs[] = {"sim.step", "sim.setStepping", "sim.wait"};
+
+struct RemoteAPIPoolConnections
+{
+    std::mutex mutex;
+    std::map<std::thread::id, std::unique_ptr<RemoteAPIClient>> byThread;
+};
+
+struct RemoteAPIPoolThread
+{ // per thread: the pools it opened a connection in, which close it when the thread exits
+    std::vector<std::weak_ptr<RemoteAPIPoolConnections>> pools;
+
+    ~RemoteAPIPoolThread()
+    {
+        for(auto &pool : pools)
+        {
+            auto c = pool.lock();
+            if(!c)
+                continue; // the pool is gone, and closed the connection with it
+            // closed under the lock: the pool's destructor then waits for it before it ends the session
+            std::lock_guard<std::mutex> lock(c->mutex);
+            c->byThread.erase(std::this_thread::get_id());
+        }
+    }
+};
+
+static thread_local RemoteAPIPoolThread poolThread;
+
+RemoteAPIClientPool::RemoteAPIClientPool(const std::string host, int rpcPort, int cntPort, int verbose_)
+    : host(host),
+      rpcPort(rpcPort),
+      cntPort(cntPort),
+      verbose(verbose_),
+      stepping(std::this_thread::get_id()),
+      primary(std::make_unique<RemoteAPIClient>(host, rpcPort, cntPort, verbose_)),
+      connections(std::make_shared<RemoteAPIPoolConnections>())
+{
+}
+
+RemoteAPIClientPool::~RemoteAPIClientPool()
+{
+    std::map<std::thread::id, std::unique_ptr<RemoteAPIClient>> open;
+    {
+        std::lock_guard<std::mutex> lock(connections->mutex);
+        open.swap(connections->byThread);
+    }
+    open.clear(); // before primary, so that the session ends after every other connection closed
+}
+
+RemoteAPIClient & RemoteAPIClientPool::client()
+{
+    const std::thread::id id = std::this_thread::get_id();
+    if(id == stepping)
+        return *primary;
+
+    std::lock_guard<std::mutex> lock(connections->mutex);
+    auto &c = connections->byThread[id];
+    if(!c)
+    {
+        c = std::make_unique<RemoteAPIClient>(primary->context(), host, rpcPort, cntPort, verbose);
+        c->_setSession(primary->uuid, false);
+        c->forbiddenFuncs.insert(std::begin(steppingFuncs), std::end(steppingFuncs));
+
+        auto &pools = poolThread.pools;
+        pools.erase(std::remove_if(pools.begin(), pools.end(), [](const auto &p) { return p.expired(); }), pools.end());
+        if(std::none_of(pools.begin(), pools.end(), [&](const auto &p) { return p.lock() == connections; }))
+            pools.push_back(connections);
+    }
+    return *c;
+}
+
+void RemoteAPIClientPool::release()
+{
+    std::unique_ptr<RemoteAPIClient> c;
+    {
+        std::lock_guard<std::mutex> lock(connections->mutex);
+        auto it = connections->byThread.find(std::this_thread::get_id());
+        if(it == connections->byThread.end())
+            return;
+        c = std::move(it->second);
+        connections->byThread.erase(it);
+    }
+    // closed outside the lock, as it may still wait for outstanding replies
+}
+
+size_t RemoteAPIClientPool::size() const
+{
+    std::lock_guard<std::mutex> lock(connections->mutex);
+    return connections->byThread.size() + 1;
+}
+
+std::thread::id RemoteAPIClientPool::steppingThread() const
+{
+    return stepping;
+}
@@ -0,0 +1,353 @@
+#include "RemoteAPIRecording.h"
+#include "RemoteAPICbor.h"
+#include <cstring>
+#include <stdexcept>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char logMagic[] = "RAPILOG1";
+static const char indexMagic[] = "RAPIIDX1";
+static const size_t entryHeaderSize = 1 + 8 + 8 + 4;
+
+static uint64_t readLE(const uint8_t *p, int bytes)
+{
+    uint64_t v = 0;
+    for(int i = bytes - 1; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static bool parseCall(std::span<const uint8_t> req, std::string_view &func, std::span<const uint8_t> &args)
+{ // func and the encoded args of a request, without decoding them
+    RemoteAPICborReader r(req.data(), req.data() + req.size());
+    if(r.peekMajor() != RemoteAPICborReader::Map || !r.findKey("func"))
+        return false;
+    func = r.readText();
+    RemoteAPICborReader a(req.data(), req.data() + req.size());
+    if(a.findKey("args"))
+    {
+        const uint8_t *b = a.position();
+        a.skip();
+        args = std::span<const uint8_t>(b, a.position());
+    }
+    return true;
+}
+
+RemoteAPIRecorder::RemoteAPIRecorder(const std::string &path)
+    : os(path, std::ios::binary | std::ios::trunc),
+      start(std::chrono::steady_clock::now())
+{
+    if(!os)
+        throw std::runtime_error("cannot write " + path);
+    os.write(logMagic, 8);
+    offset = 8;
+}
+
+RemoteAPIRecorder::~RemoteAPIRecorder()
+{
+    close();
+}
+
+void RemoteAPIRecorder::_write(uint64_t v, int bytes)
+{
+    char b[8];
+    for(int i = 0; i < bytes; i++, v >>= 8)
+        b[i] = char(v & 0xff);
+    os.write(b, bytes);
+}
+
+void RemoteAPIRecorder::record(uint8_t kind, uint64_t id, std::span<const uint8_t> payload)
+{
+    if(!os.is_open())
+        return;
+    const auto t = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    index.push_back(offset);
+    _write(kind, 1);
+    _write(id, 8);
+    _write(uint64_t(t.count()), 8);
+    _write(payload.size(), 4);
+    os.write(reinterpret_cast<const char *>(payload.data()), std::streamsize(payload.size()));
+    offset += entryHeaderSize + payload.size();
+}
+
+void RemoteAPIRecorder::close()
+{
+    if(!os.is_open())
+        return;
+    for(uint64_t o : index)
+        _write(o, 8);
+    _write(index.size(), 8);
+    _write(offset, 8);
+    os.write(indexMagic, 8);
+    os.close();
+}
+
+RemoteAPIRecording::RemoteAPIRecording(const std::string &path)
+{
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER fileSize;
+    if(file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize))
+    {
+        _unmap();
+        throw std::runtime_error("cannot open " + path);
+    }
+    length = size_t(fileSize.QuadPart);
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping)
+        data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0)
+    {
+        if(fd >= 0)
+            ::close(fd);
+        throw std::runtime_error("cannot open " + path);
+    }
+    length = size_t(st.st_size);
+    void *p = length ? mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if(p != MAP_FAILED)
+        data = static_cast<const uint8_t *>(p);
+#endif
+    if(!data || length < 8 || std::memcmp(data, logMagic, 8) != 0)
+    {
+        _unmap();
+        throw std::runtime_error(path + " is not a remote API recording");
+    }
+
+    if(length >= 8 + 24 && std::memcmp(data + length - 8, indexMagic, 8) == 0)
+    {
+        const uint64_t count = readLE(data + length - 24, 8);
+        const uint64_t at = readLE(data + length - 16, 8);
+        if(at + count * 8 + 24 == length)
+        {
+            index.reserve(count);
+            for(uint64_t i = 0; i < count; i++)
+                index.push_back(readLE(data + at + i * 8, 8));
+            return;
+        }
+    }
+    _scan();
+}
+
+RemoteAPIRecording::~RemoteAPIRecording()
+{
+    _unmap();
+}
+
+void RemoteAPIRecording::_unmap()
+{
+#ifdef _WIN32
+    if(data)
+        UnmapViewOfFile(data);
+    if(mapping)
+        CloseHandle(mapping);
+    if(file && file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    data = nullptr;
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if(data)
+        munmap(const_cast<uint8_t *>(data), length);
+    data = nullptr;
+#endif
+}
+
+void RemoteAPIRecording::_scan()
+{ // no index: the recorder did not finish; everything up to the last complete entry is usable
+    size_t pos = 8;
+    while(pos + entryHeaderSize <= length)
+    {
+        const size_t size = size_t(readLE(data + pos + 17, 4));
+        if(pos + entryHeaderSize + size > length)
+            break;
+        index.push_back(pos);
+        pos += entryHeaderSize + size;
+    }
+}
+
+size_t RemoteAPIRecording::size() const
+{
+    return index.size();
+}
+
+RemoteAPIRecording::Entry RemoteAPIRecording::operator[](size_t i) const
+{
+    const uint8_t *p = data + index.at(i);
+    Entry e;
+    e.kind = Kind(p[0]);
+    e.id = readLE(p + 1, 8);
+    e.time = std::chrono::nanoseconds(readLE(p + 9, 8));
+    e.payload = std::span<const uint8_t>(p + entryHeaderSize, size_t(readLE(p + 17, 4)));
+    return e;
+}
+
+RemoteAPIReplay::RemoteAPIReplay(const std::string &path, zmq::context_t &ctx)
+    : recording(path),
+      socket(ctx, zmq::socket_type::router),
+      used(recording.size(), false)
+{
+    for(size_t i = 0; i < recording.size(); i++)
+    {
+        const auto e = recording[i];
+        if(e.kind == RemoteAPIRecording::Reply)
+        {
+            replies[e.id].push_back(i);
+            continue;
+        }
+        std::string_view func;
+        std::span<const uint8_t> args;
+        if(!parseCall(e.payload, func, args) || func == "_*executed*_")
+            continue; // continuations are answered through the call they belong to
+        std::string key(func);
+        key.append(reinterpret_cast<const char *>(args.data()), args.size());
+        byCall[key].push_back(i);
+        byFunc[std::string(func)].push_back(i);
+    }
+}
+
+RemoteAPIReplay::~RemoteAPIReplay()
+{
+    stop();
+}
+
+void RemoteAPIReplay::bind(const std::string &endpoint)
+{
+    socket.bind(endpoint);
+}
+
+bool RemoteAPIReplay::serveOnce(int timeoutMs)
+{
+    socket.set(zmq::sockopt::rcvtimeo, timeoutMs);
+    zmq::message_t first;
+    if(!socket.recv(first))
+        return false;
+
+    // routing id, the client's envelope (request id, delimiter), then the payload
+    std::vector<zmq::message_t> frames;
+    frames.push_back(std::move(first));
+    while(frames.back().more())
+    {
+        zmq::message_t part;
+        if(!socket.recv(part))
+            throw std::runtime_error("incomplete request");
+        frames.push_back(std::move(part));
+    }
+
+    uint64_t liveId = 0;
+    if(frames.size() >= 3 && frames[1].size() == sizeof(liveId))
+        std::memcpy(&liveId, frames[1].data(), sizeof(liveId));
+    const zmq::message_t &payload = frames.back();
+    std::vector<uint8_t> reply = _answer(std::span<const uint8_t>(static_cast<const uint8_t *>(payload.data()), payload.size()), liveId);
+
+    for(size_t i = 0; i + 1 < frames.size(); i++)
+        socket.send(frames[i], zmq::send_flags::sndmore);
+    socket.send(zmq::buffer(reply), zmq::send_flags::none);
+    return true;
+}
+
+void RemoteAPIReplay::start()
+{
+    if(server.joinable())
+        return;
+    stopping = false;
+    server = std::thread([this]()
+    {
+        try
+        {
+            while(!stopping.load(std::memory_order_relaxed))
+                serveOnce(100);
+        }
+        catch(const std::exception &)
+        { // e.g. the shared context is terminating, which waits for this socket
+            socket.close();
+        }
+    });
+}
+
+void RemoteAPIReplay::stop()
+{
+    if(server.joinable())
+    {
+        stopping = true;
+        server.join();
+    }
+}
+
+uint64_t RemoteAPIReplay::unmatched() const
+{
+    return unmatchedCount.load(std::memory_order_relaxed);
+}
+
+int64_t RemoteAPIReplay::_pop(std::deque<size_t> &queue, const std::vector<bool> &used)
+{
+    while(!queue.empty() && used[queue.front()])
+        queue.pop_front();
+    if(queue.empty())
+        return -1;
+    const size_t i = queue.front();
+    queue.pop_front();
+    return int64_t(i);
+}
+
+std::vector<uint8_t> RemoteAPIReplay::_answer(std::span<const uint8_t> request, uint64_t liveId)
+{
+    std::string_view func;
+    std::span<const uint8_t> args;
+    std::string err;
+    try
+    {
+        if(!parseCall(request, func, args))
+            throw std::runtime_error("request without func");
+
+        if(func != "_*executed*_")
+        {
+            std::string key(func);
+            key.append(reinterpret_cast<const char *>(args.data()), args.size());
+            int64_t i = -1;
+            if(auto it = byCall.find(key); it != byCall.end())
+                i = _pop(it->second, used);
+            if(auto it = byFunc.find(func); i < 0 && it != byFunc.end())
+                i = _pop(it->second, used);
+            if(i >= 0)
+            {
+                used[size_t(i)] = true;
+                liveToRecorded[liveId] = recording[size_t(i)].id;
+            }
+            else
+                liveToRecorded.erase(liveId);
+        }
+
+        auto it = liveToRecorded.find(liveId);
+        auto r = it != liveToRecorded.end() ? replies.find(it->second) : replies.end();
+        if(r != replies.end() && !r->second.empty())
+        {
+            const auto payload = recording[r->second.front()].payload;
+            r->second.pop_front();
+            return std::vector<uint8_t>(payload.begin(), payload.end());
+        }
+        err = "no recorded reply for " + std::string(func);
+    }
+    catch(const std::exception &ex)
+    {
+        err = ex.what();
+    }
+
+    unmatchedCount++;
+    std::vector<uint8_t> out;
+    RemoteAPICborWriter w(out);
+    w.writeMapHeader(1);
+    w.writeText("err");
+    w.writeText(err);
+    return out;
+}
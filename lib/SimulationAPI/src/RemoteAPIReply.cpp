@@ -0,0 +1,71 @@
+#include "RemoteAPIReply.h"
+#include <stdexcept>
+#include <string>
+#include <jsoncons_ext/cbor/cbor.hpp>
+
+RemoteAPIReply::RemoteAPIReply(zmq::message_t msg_)
+    : msg(std::move(msg_))
+{
+}
+
+const uint8_t * RemoteAPIReply::data() const
+{
+    return static_cast<const uint8_t *>(msg.data());
+}
+
+size_t RemoteAPIReply::size() const
+{
+    return msg.size();
+}
+
+RemoteAPICborReader RemoteAPIReply::reader() const
+{
+    return RemoteAPICborReader(data(), data() + size());
+}
+
+bool RemoteAPIReply::contains(std::string_view key) const
+{
+    auto r = reader();
+    return r.peekMajor() == RemoteAPICborReader::Map && r.findKey(key);
+}
+
+json RemoteAPIReply::decode() const
+{
+    return cbor::decode_cbor<json>(data(), data() + size());
+}
+
+json RemoteAPIReply::ret() const
+{
+    auto r = reader();
+    if(!r.findKey("ret"))
+        return json(json_array_arg);
+    const uint8_t *b = r.position();
+    r.skip();
+    return cbor::decode_cbor<json>(b, r.position());
+}
+
+RemoteAPICborReader RemoteAPIReply::retReader(size_t index) const
+{
+    auto r = reader();
+    if(!r.findKey("ret"))
+        throw std::runtime_error("reply has no return values");
+    uint64_t n = r.readArrayHeader();
+    if(index >= n)
+        throw std::runtime_error("return value index " + std::to_string(index) + " out of range");
+    for(size_t i = 0; i < index; i++)
+        r.skip();
+    return r;
+}
+
+json RemoteAPIReply::ret(size_t index) const
+{
+    auto r = retReader(index);
+    const uint8_t *b = r.position();
+    r.skip();
+    return cbor::decode_cbor<json>(b, r.position());
+}
+
+std::span<const uint8_t> RemoteAPIReply::bytes(size_t index) const
+{
+    return retReader(index).readBytes();
+}
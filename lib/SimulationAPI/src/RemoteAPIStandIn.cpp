@@ -0,0 +1,385 @@
+#include "RemoteAPIStandIn.h"
+#include <algorithm>
+#include <stdexcept>
+#include <jsoncons_ext/cbor/cbor.hpp>
+
+int64_t RemoteAPIStandInBackend::objectHandle(const std::string &path)
+{
+    auto it = handles.find(path);
+    if(it != handles.end())
+        return it->second;
+    const int64_t h = nextHandle++;
+    handles.emplace(path, h);
+    paths.emplace(h, path);
+    return h;
+}
+
+int64_t RemoteAPIStandInBackend::scriptHandle(int64_t scriptType, const std::string &path)
+{
+    return objectHandle(path.empty() ? "script:" + std::to_string(scriptType) : path);
+}
+
+const std::string & RemoteAPIStandInBackend::objectPath(int64_t handle) const
+{
+    static const std::string unknown;
+    auto it = paths.find(handle);
+    return it != paths.end() ? it->second : unknown;
+}
+
+std::array<double, 3> RemoteAPIStandInBackend::position(int64_t)
+{
+    return {0.0, 0.0, 0.0};
+}
+
+std::array<double, 3> RemoteAPIStandInBackend::orientation(int64_t)
+{
+    return {0.0, 0.0, 0.0};
+}
+
+void RemoteAPIStandInBackend::addForceAndTorque(int64_t, const std::array<double, 3> &, const std::array<double, 3> &)
+{
+}
+
+void RemoteAPIStandInBackend::visionSensorImage(int64_t, std::vector<uint8_t> &rgb, int64_t &resX, int64_t &resY)
+{
+    resX = 512;
+    resY = 512;
+    rgb.assign(size_t(resX * resY * 3), 128);
+}
+
+void RemoteAPIStandInBackend::visionSensorWindow(int64_t handle, bool gray, int64_t x, int64_t y, int64_t &resX, int64_t &resY, std::vector<uint8_t> &out)
+{
+    int64_t fullX, fullY;
+    visionSensorImage(handle, frame, fullX, fullY);
+    if(resX <= 0 || resY <= 0)
+    {
+        x = y = 0;
+        resX = fullX;
+        resY = fullY;
+    }
+    if(x < 0 || y < 0 || x + resX > fullX || y + resY > fullY)
+        throw std::runtime_error("sim.getVisionSensorImg: window exceeds the image");
+
+    out.resize(size_t(resX * resY * (gray ? 1 : 3)));
+    uint8_t *o = out.data();
+    for(int64_t r = 0; r < resY; r++)
+    {
+        const uint8_t *in = frame.data() + ((y + r) * fullX + x) * 3;
+        if(!gray)
+        {
+            o = std::copy(in, in + resX * 3, o);
+            continue;
+        }
+        for(int64_t c = 0; c < resX; c++, in += 3)
+            *o++ = uint8_t((in[0] + in[1] + in[2]) / 3);
+    }
+}
+
+json RemoteAPIStandInBackend::callScriptFunction(const std::string &func, int64_t script, const json &)
+{
+    throw std::runtime_error("no function " + func + " in script " + std::to_string(script));
+}
+
+void RemoteAPIStandInBackend::startSimulation()
+{
+    time = 0.0;
+}
+
+void RemoteAPIStandInBackend::stopSimulation()
+{
+}
+
+void RemoteAPIStandInBackend::step()
+{
+    time += dt;
+}
+
+double RemoteAPIStandInBackend::simulationTime() const
+{
+    return time;
+}
+
+double RemoteAPIStandInBackend::timeStep() const
+{
+    return dt;
+}
+
+RemoteAPIStandIn::RemoteAPIStandIn(RemoteAPIStandInBackend &backend_)
+    : ownCtx(std::make_unique<zmq::context_t>()),
+      ctx(ownCtx.get()),
+      socket(*ctx, zmq::socket_type::router),
+      backend(&backend_)
+{
+}
+
+RemoteAPIStandIn::RemoteAPIStandIn(RemoteAPIStandInBackend &backend_, zmq::context_t &ctx_)
+    : ctx(&ctx_),
+      socket(*ctx, zmq::socket_type::router),
+      backend(&backend_)
+{
+}
+
+RemoteAPIStandIn::~RemoteAPIStandIn()
+{
+    stop();
+}
+
+void RemoteAPIStandIn::bind(const std::string &endpoint)
+{
+    socket.bind(endpoint);
+}
+
+void RemoteAPIStandIn::setRepeatInterval(unsigned n)
+{
+    repeatInterval = n;
+    callsSinceRepeat = 0;
+}
+
+bool RemoteAPIStandIn::serveOnce(int timeoutMs)
+{
+    socket.set(zmq::sockopt::rcvtimeo, timeoutMs);
+    zmq::message_t first;
+    if(!socket.recv(first))
+        return false;
+
+    // routing id, the client's envelope, then the payload
+    std::vector<zmq::message_t> frames;
+    frames.push_back(std::move(first));
+    while(frames.back().more())
+    {
+        zmq::message_t part;
+        if(!socket.recv(part))
+            throw std::runtime_error("incomplete request");
+        frames.push_back(std::move(part));
+    }
+    requests++;
+
+    const zmq::message_t &payload = frames.back();
+    const std::string_view routingId(static_cast<const char *>(frames[0].data()), frames[0].size());
+    try
+    {
+        const auto data = static_cast<const uint8_t *>(payload.data());
+        _handle(cbor::decode_cbor<json>(data, data + payload.size()), routingId, out);
+    }
+    catch(const std::exception &ex)
+    {
+        out.clear();
+        RemoteAPICborWriter w(out);
+        w.writeMapHeader(1);
+        w.writeText("err");
+        w.writeText(ex.what());
+    }
+
+    for(size_t i = 0; i + 1 < frames.size(); i++)
+        socket.send(frames[i], zmq::send_flags::sndmore);
+    socket.send(zmq::buffer(out), zmq::send_flags::none);
+    return true;
+}
+
+void RemoteAPIStandIn::start()
+{
+    if(server.joinable())
+        return;
+    stopping = false;
+    server = std::thread([this]()
+    {
+        try
+        {
+            while(!stopping.load(std::memory_order_relaxed))
+                serveOnce(100);
+        }
+        catch(const std::exception &)
+        { // e.g. the shared context is terminating, which waits for this socket
+            socket.close();
+        }
+    });
+}
+
+void RemoteAPIStandIn::stop()
+{
+    if(server.joinable())
+    {
+        stopping = true;
+        server.join();
+    }
+}
+
+uint64_t RemoteAPIStandIn::requestCount() const
+{
+    return requests.load(std::memory_order_relaxed);
+}
+
+void RemoteAPIStandIn::_handle(const json &req, std::string_view routingId, std::vector<uint8_t> &out)
+{
+    out.clear();
+    RemoteAPICborWriter w(out);
+    std::string func = req.at("func").as<std::string>();
+    const json noArgs(json_array_arg);
+    const json &args = req.contains("args") ? req.at("args") : noArgs;
+
+    if(func == "_*executed*_")
+    { // the client is done with the _*wait*_: now really run the call
+        auto it = waiting.find(routingId);
+        if(it == waiting.end())
+            throw std::runtime_error("nothing waits for _*executed*_");
+        func = it->second;
+        waiting.erase(it);
+        w.writeMapHeader(1);
+        w.writeText("ret");
+        w.write(_dispatch(func, noArgs));
+        return;
+    }
+
+    if(repeatInterval > 0 && func != "_*end*_" && ++callsSinceRepeat >= repeatInterval)
+    {
+        callsSinceRepeat = 0;
+        w.writeMapHeader(2);
+        w.writeText("func");
+        w.writeText("_*repeat*_");
+        w.writeText("args");
+        w.writeArrayHeader(0);
+        return;
+    }
+
+    if(func == "sim.step")
+    { // the real server yields here until the step is done
+        waiting.insert_or_assign(std::string(routingId), func);
+        w.writeMapHeader(2);
+        w.writeText("func");
+        w.writeText("_*wait*_");
+        w.writeText("args");
+        w.writeArrayHeader(0);
+        return;
+    }
+
+    if(func == "sim.getVisionSensorImg" && args.size() > 0)
+    { // written straight from the backend's buffer
+        int64_t resX, resY;
+        const std::vector<uint8_t> &img = _image(args, resX, resY);
+        w.writeMapHeader(1);
+        w.writeText("ret");
+        w.writeArrayHeader(2);
+        w.writeBytes(img);
+        w.writeArrayHeader(2);
+        w.writeInt(resX);
+        w.writeInt(resY);
+        return;
+    }
+
+    w.writeMapHeader(1);
+    w.writeText("ret");
+    w.write(_dispatch(func, args));
+}
+
+json RemoteAPIStandIn::_dispatch(const std::string &func, const json &args)
+{ // returns the return values as array; throws for errors, which are replied as err
+    auto arg = [&](size_t i) -> const json &
+    {
+        if(!args.is_array() || i >= args.size())
+            throw std::runtime_error(func + ": missing argument " + std::to_string(i + 1));
+        return args[i];
+    };
+    auto vec3 = [&](size_t i)
+    {
+        std::array<double, 3> v{};
+        if(args.is_array() && i < args.size() && args[i].is_array())
+            for(size_t k = 0; k < 3 && k < args[i].size(); k++)
+                v[k] = args[i][k].as<double>();
+        return v;
+    };
+    auto ret3 = [](const std::array<double, 3> &v)
+    {
+        return json(json_array_arg, {json(json_array_arg, {v[0], v[1], v[2]})});
+    };
+    const json none(json_array_arg);
+
+    if(func == "zmqRemoteApi.require" || func == "_*end*_" || func == "sim.setStepping")
+        return none;
+    if(func == "sim.getObject")
+        return json(json_array_arg, {backend->objectHandle(arg(0).as<std::string>())});
+    if(func == "sim.getScript")
+        return json(json_array_arg, {backend->scriptHandle(arg(0).as<int64_t>(), args.size() > 1 ? args[1].as<std::string>() : std::string())});
+    if(func == "sim.executeScriptString")
+        return json(json_array_arg, {0, json(null_type())}); // e.g. the batch helper, which is built in here
+    if(func == "sim.callScriptFunction")
+    {
+        const std::string name = arg(0).as<std::string>();
+        if(name == "_remoteApiBatch")
+            return json(json_array_arg, {_batch(arg(2))});
+        json inArgs(json_array_arg);
+        for(size_t i = 2; i < args.size(); i++)
+            inArgs.push_back(args[i]);
+        return backend->callScriptFunction(name, arg(1).as<int64_t>(), inArgs);
+    }
+    if(func == "sim.getVisionSensorImg")
+    {
+        int64_t resX, resY;
+        const std::vector<uint8_t> &img = _image(args, resX, resY);
+        return json(json_array_arg, {json(byte_string_arg, img), json(json_array_arg, {resX, resY})});
+    }
+    if(func == "sim.getObjectPosition")
+        return ret3(backend->position(arg(0).as<int64_t>()));
+    if(func == "sim.getObjectOrientation")
+        return ret3(backend->orientation(arg(0).as<int64_t>()));
+    if(func == "sim.addForceAndTorque")
+    {
+        backend->addForceAndTorque(arg(0).as<int64_t>(), vec3(1), vec3(2));
+        return none;
+    }
+    if(func == "sim.step")
+    {
+        backend->step();
+        return none;
+    }
+    if(func == "sim.startSimulation")
+    {
+        backend->startSimulation();
+        return json(json_array_arg, {1});
+    }
+    if(func == "sim.stopSimulation")
+    {
+        backend->stopSimulation();
+        return json(json_array_arg, {1});
+    }
+    if(func == "sim.getSimulationTime")
+        return json(json_array_arg, {backend->simulationTime()});
+    if(func == "sim.getSimulationTimeStep")
+        return json(json_array_arg, {backend->timeStep()});
+    throw std::runtime_error(func + " is not supported by the stand-in");
+}
+
+const std::vector<uint8_t> & RemoteAPIStandIn::_image(const json &args, int64_t &resX, int64_t &resY)
+{ // sim.getVisionSensorImg(handle, options, rgbaCutOff, pos, size); options bit 0: greyscale
+    if(args.size() == 0)
+        throw std::runtime_error("sim.getVisionSensorImg: missing argument 1");
+    const bool gray = args.size() > 1 && (args[1].as<int64_t>() & 1);
+    int64_t x = 0, y = 0;
+    resX = 0;
+    resY = 0;
+    if(args.size() > 4 && args[3].size() == 2 && args[4].size() == 2)
+    {
+        x = args[3][0].as<int64_t>();
+        y = args[3][1].as<int64_t>();
+        resX = args[4][0].as<int64_t>();
+        resY = args[4][1].as<int64_t>();
+    }
+    backend->visionSensorWindow(args[0].as<int64_t>(), gray, x, y, resX, resY, image);
+    return image;
+}
+
+json RemoteAPIStandIn::_batch(const json &calls)
+{ // same result shape as the Lua dispatcher installed by RemoteAPIBatch
+    json results(json_array_arg);
+    for(const auto &c : calls.array_range())
+    {
+        try
+        {
+            results.push_back(json(json_array_arg, {true, _dispatch(c[0].as<std::string>(), c[1])}));
+        }
+        catch(const std::exception &ex)
+        {
+            results.push_back(json(json_array_arg, {false, ex.what()}));
+        }
+    }
+    return results;
+}
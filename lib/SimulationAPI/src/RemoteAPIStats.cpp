@@ -0,0 +1,146 @@
+#include "RemoteAPIStats.h"
+#include <bit>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <jsoncons/json.hpp>
+
+using namespace jsoncons;
+
+size_t RemoteAPIHistogram::_index(uint64_t v)
+{ // values below subBuckets are exact; above, each power of two is split into subBuckets / 2 buckets
+    if(v < subBuckets)
+        return size_t(v);
+    const int k = std::bit_width(v) - subBucketBits;
+    return size_t(k * (subBuckets / 2) + (v >> k));
+}
+
+uint64_t RemoteAPIHistogram::_lowerBound(size_t index)
+{
+    if(index < subBuckets)
+        return index;
+    const uint64_t k = index / (subBuckets / 2) - 1;
+    return (index - k * (subBuckets / 2)) << k;
+}
+
+void RemoteAPIHistogram::record(std::chrono::nanoseconds value)
+{
+    const uint64_t v = value.count() > 0 ? uint64_t(value.count()) : 0;
+    counts[_index(v)]++;
+    n++;
+    total += v;
+    minValue = std::min(minValue, v);
+    maxValue = std::max(maxValue, v);
+}
+
+uint64_t RemoteAPIHistogram::count() const
+{
+    return n;
+}
+
+std::chrono::nanoseconds RemoteAPIHistogram::min() const
+{
+    return std::chrono::nanoseconds(n ? minValue : 0);
+}
+
+std::chrono::nanoseconds RemoteAPIHistogram::max() const
+{
+    return std::chrono::nanoseconds(maxValue);
+}
+
+std::chrono::nanoseconds RemoteAPIHistogram::mean() const
+{
+    return std::chrono::nanoseconds(n ? total / n : 0);
+}
+
+std::chrono::nanoseconds RemoteAPIHistogram::percentile(double p) const
+{
+    if(n == 0)
+        return std::chrono::nanoseconds(0);
+    const uint64_t target = std::max<uint64_t>(1, uint64_t(std::ceil(p / 100.0 * double(n))));
+    uint64_t seen = 0;
+    for(size_t i = 0; i < counts.size(); i++)
+    {
+        seen += counts[i];
+        if(seen >= target)
+        {
+            const uint64_t upper = i + 1 < counts.size() ? _lowerBound(i + 1) - 1 : UINT64_MAX;
+            return std::chrono::nanoseconds(std::min(upper, maxValue));
+        }
+    }
+    return max();
+}
+
+void RemoteAPIHistogram::reset()
+{
+    *this = RemoteAPIHistogram();
+}
+
+void RemoteAPICallStats::reset()
+{
+    *this = RemoteAPICallStats();
+}
+
+static const std::pair<const char *, RemoteAPIHistogram RemoteAPICallStats::*> phases[] = {
+    {"encode", &RemoteAPICallStats::encode},
+    {"wire", &RemoteAPICallStats::wire},
+    {"decode", &RemoteAPICallStats::decode},
+};
+
+static double us(std::chrono::nanoseconds t)
+{
+    return double(t.count()) / 1e3;
+}
+
+void writeCallStatsCsv(std::ostream &os, const RemoteAPICallStatsMap &stats)
+{
+    os << "func,calls,bytes_sent,bytes_received,timeouts,phase,count,mean_us,p50_us,p90_us,p99_us,max_us\n";
+    for(const auto &[func, s] : stats)
+    {
+        for(const auto &[phase, member] : phases)
+        {
+            const RemoteAPIHistogram &h = s.*member;
+            os << func << ',' << s.calls << ',' << s.bytesSent << ',' << s.bytesReceived << ',' << s.timeouts << ',' << phase << ','
+               << h.count() << ',' << us(h.mean()) << ',' << us(h.percentile(50)) << ',' << us(h.percentile(90)) << ','
+               << us(h.percentile(99)) << ',' << us(h.max()) << '\n';
+        }
+    }
+}
+
+void writeCallStatsJson(std::ostream &os, const RemoteAPICallStatsMap &stats)
+{
+    json j(json_object_arg);
+    for(const auto &[func, s] : stats)
+    {
+        json f(json_object_arg);
+        f["calls"] = s.calls;
+        f["bytesSent"] = s.bytesSent;
+        f["bytesReceived"] = s.bytesReceived;
+        f["timeouts"] = s.timeouts;
+        for(const auto &[phase, member] : phases)
+        {
+            const RemoteAPIHistogram &h = s.*member;
+            json p(json_object_arg);
+            p["count"] = h.count();
+            p["meanUs"] = us(h.mean());
+            p["p50Us"] = us(h.percentile(50));
+            p["p90Us"] = us(h.percentile(90));
+            p["p99Us"] = us(h.percentile(99));
+            p["maxUs"] = us(h.max());
+            f[phase] = std::move(p);
+        }
+        j[func] = std::move(f);
+    }
+    os << pretty_print(j) << '\n';
+}
+
+void writeCallStats(const std::string &path, const RemoteAPICallStatsMap &stats)
+{
+    std::ofstream os(path);
+    if(!os)
+        throw std::runtime_error("cannot write " + path);
+    if(path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0)
+        writeCallStatsJson(os, stats);
+    else
+        writeCallStatsCsv(os, stats);
+}
@@ -0,0 +1,283 @@
+#include "RemoteAPIStream.h"
+#include <stdexcept>
+
+static const char *streamHelperCode = R"lua(
+local simZMQ = require 'simZMQ'
+local ctx, sock, sources, step = nil, nil, {}, 0
+
+local function cborHead(major, n)
+    if n < 24 then return string.char(major * 32 + n) end
+    if n < 0x100 then return string.char(major * 32 + 24, n) end
+    if n < 0x10000 then return string.char(major * 32 + 25) .. string.pack('>I2', n) end
+    if n < 0x100000000 then return string.char(major * 32 + 26) .. string.pack('>I4', n) end
+    return string.char(major * 32 + 27) .. string.pack('>I8', n)
+end
+
+local function cborEncode(v, binary)
+    local t = type(v)
+    if t == 'boolean' then return v and '\xf5' or '\xf4' end
+    if math.type(v) == 'integer' then return v >= 0 and cborHead(0, v) or cborHead(1, -1 - v) end
+    if t == 'number' then return '\xfb' .. string.pack('>d', v) end
+    if t == 'string' then return cborHead(binary and 2 or 3, #v) .. v end
+    if t == 'table' then
+        local parts = {}
+        if #v > 0 or next(v) == nil then
+            for i = 1, #v do parts[i] = cborEncode(v[i], binary) end
+            return cborHead(4, #v) .. table.concat(parts)
+        end
+        for k, x in pairs(v) do parts[#parts + 1] = cborEncode(k) .. cborEncode(x, binary) end
+        return cborHead(5, #parts) .. table.concat(parts)
+    end
+    return '\xf6'
+end
+
+function _remoteApiStreamStart(endpoint, srcs)
+    for i, s in ipairs(srcs) do
+        local f = _G
+        for part in string.gmatch(s[1], '[^%.]+') do
+            f = type(f) == 'table' and f[part] or nil
+        end
+        if type(f) ~= 'function' then error('No such function: ' .. s[1]) end
+        sources[i] = {f = f, args = s[2], binary = s[3]}
+    end
+    ctx = simZMQ.ctx_new()
+    sock = simZMQ.socket(ctx, simZMQ.PUB)
+    simZMQ.bind(sock, endpoint)
+end
+
+function sysCall_sensing()
+    if not sock then return end
+    step = step + 1
+    local parts = {}
+    for i, s in ipairs(sources) do
+        local r = table.pack(s.f(table.unpack(s.args)))
+        local values = {}
+        for j = 1, r.n do values[j] = cborEncode(r[j], s.binary) end
+        parts[i] = cborHead(4, r.n) .. table.concat(values)
+    end
+    simZMQ.send(sock, cborHead(5, 3)
+        .. cborEncode('step') .. cborEncode(step)
+        .. cborEncode('t') .. cborEncode(sim.getSimulationTime())
+        .. cborEncode('ret') .. cborHead(4, #parts) .. table.concat(parts), 0)
+end
+
+function sysCall_cleanup()
+    if sock then
+        simZMQ.close(sock)
+        simZMQ.ctx_term(ctx)
+    end
+end
+)lua";
+
+RemoteAPISnapshot::RemoteAPISnapshot(zmq::message_t msg_)
+    : msg(std::move(msg_))
+{ // {step, t, ret: [[values of source 0], [values of source 1], ...]}
+    auto r = msg.reader();
+    for(uint64_t n = r.readMapHeader(); n > 0; n--)
+    {
+        std::string_view key = r.readText();
+        if(key == "step")
+            stepNumber = uint64_t(r.readInt());
+        else if(key == "t")
+            simTime = r.readDouble();
+        else
+        {
+            if(key == "ret")
+                sources = size_t(RemoteAPICborReader(r).readArrayHeader());
+            r.skip();
+        }
+    }
+}
+
+uint64_t RemoteAPISnapshot::step() const
+{
+    return stepNumber;
+}
+
+double RemoteAPISnapshot::simulationTime() const
+{
+    return simTime;
+}
+
+size_t RemoteAPISnapshot::sourceCount() const
+{
+    return sources;
+}
+
+json RemoteAPISnapshot::values(size_t source) const
+{
+    return msg.ret(source);
+}
+
+RemoteAPICborReader RemoteAPISnapshot::reader(size_t source, size_t index) const
+{
+    auto r = msg.retReader(source);
+    if(index >= r.readArrayHeader())
+        throw std::runtime_error("source " + std::to_string(source) + " has no value " + std::to_string(index));
+    for(size_t i = 0; i < index; i++)
+        r.skip();
+    return r;
+}
+
+json RemoteAPISnapshot::value(size_t source, size_t index) const
+{
+    auto r = reader(source, index);
+    const uint8_t *b = r.position();
+    r.skip();
+    return cbor::decode_cbor<json>(b, r.position());
+}
+
+std::span<const uint8_t> RemoteAPISnapshot::bytes(size_t source, size_t index) const
+{
+    return reader(source, index).readBytes();
+}
+
+const RemoteAPIReply & RemoteAPISnapshot::message() const
+{
+    return msg;
+}
+
+RemoteAPIStream::RemoteAPIStream(RemoteAPIClient &client_, size_t queueCapacity)
+    : client(&client_),
+      sources(json_array_arg),
+      ring(queueCapacity + 1)
+{
+}
+
+RemoteAPIStream::~RemoteAPIStream()
+{
+    try
+    {
+        stop();
+    }
+    catch(const std::exception &)
+    {
+    }
+}
+
+size_t RemoteAPIStream::addSource(const std::string &func, const json &args, bool binary)
+{
+    if(running())
+        throw std::runtime_error("RemoteAPIStream: sources cannot change while streaming");
+    sources.push_back(json(json_array_arg, {json(func), args, json(binary)}));
+    return sources.size() - 1;
+}
+
+void RemoteAPIStream::start()
+{
+    if(running())
+        return;
+
+    const std::string endpoint = client->streamEndpoint();
+    zmq::socket_t socket(client->context(), zmq::socket_type::sub);
+    socket.set(zmq::sockopt::subscribe, "");
+    socket.set(zmq::sockopt::rcvtimeo, 100); // lets the receiver notice stop()
+    socket.set(zmq::sockopt::linger, 0);
+    socket.connect(endpoint);
+
+    // the scene binds the same endpoint, on all interfaces for tcp
+    std::string bindEndpoint = endpoint;
+    if(bindEndpoint.rfind("tcp://", 0) == 0)
+        bindEndpoint = "tcp://*" + bindEndpoint.substr(bindEndpoint.rfind(':'));
+
+    script = client->call("sim.createScript", {6 /* sim.scripttype_customization */, streamHelperCode, 0, "lua"})[0].as<int64_t>();
+    try
+    {
+        client->call("sim.initScript", {script});
+        client->call("sim.callScriptFunction", {"_remoteApiStreamStart", script, bindEndpoint, sources});
+    }
+    catch(const std::exception &)
+    {
+        client->call("sim.removeObjects", {json(json_array_arg, {script})});
+        script = -1;
+        throw;
+    }
+
+    stopping = false;
+    receiver = std::thread(&RemoteAPIStream::_receive, this, std::move(socket));
+}
+
+void RemoteAPIStream::stop()
+{
+    if(receiver.joinable())
+    {
+        stopping = true;
+        receiver.join();
+    }
+    if(script != -1)
+    {
+        const int64_t s = script;
+        script = -1;
+        client->call("sim.removeObjects", {json(json_array_arg, {s})});
+    }
+}
+
+bool RemoteAPIStream::running() const
+{
+    return script != -1;
+}
+
+RemoteAPIStream::Snapshot RemoteAPIStream::latest() const
+{
+    if(middle.load(std::memory_order_relaxed) & slotFresh)
+        front = middle.exchange(front, std::memory_order_acq_rel) & slotIndex;
+    return slots[front];
+}
+
+bool RemoteAPIStream::pop(Snapshot &snapshot)
+{
+    const size_t h = head.load(std::memory_order_relaxed);
+    if(h == tail.load(std::memory_order_acquire))
+        return false;
+    snapshot = std::move(ring[h]);
+    head.store((h + 1) % ring.size(), std::memory_order_release);
+    return true;
+}
+
+uint64_t RemoteAPIStream::received() const
+{
+    return receivedCount.load(std::memory_order_relaxed);
+}
+
+uint64_t RemoteAPIStream::dropped() const
+{
+    return droppedCount.load(std::memory_order_relaxed);
+}
+
+void RemoteAPIStream::_receive(zmq::socket_t socket)
+{
+    while(!stopping.load(std::memory_order_relaxed))
+    {
+        zmq::message_t msg;
+        if(!socket.recv(msg))
+            continue; // timed out
+
+        Snapshot snapshot;
+        try
+        {
+            snapshot = std::make_shared<const RemoteAPISnapshot>(std::move(msg));
+        }
+        catch(const std::exception &)
+        {
+            droppedCount++;
+            continue;
+        }
+        receivedCount++;
+        slots[back] = snapshot;
+        back = middle.exchange(back | slotFresh, std::memory_order_acq_rel) & slotIndex;
+        _push(std::move(snapshot));
+    }
+}
+
+void RemoteAPIStream::_push(Snapshot snapshot)
+{ // never blocks the receiver: a full queue drops the new snapshot, which is still available as latest()
+    const size_t t = tail.load(std::memory_order_relaxed);
+    const size_t next = (t + 1) % ring.size();
+    if(next == head.load(std::memory_order_acquire))
+    {
+        droppedCount++;
+        return;
+    }
+    ring[t] = std::move(snapshot);
+    tail.store(next, std::memory_order_release);
+}
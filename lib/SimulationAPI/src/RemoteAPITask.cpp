@@ -0,0 +1,187 @@
+#include "RemoteAPITask.h"
+#include <algorithm>
+#include <stdexcept>
+
+static thread_local RemoteAPIScheduler *currentScheduler = nullptr;
+
+std::coroutine_handle<> RemoteAPITask::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> h) noexcept
+{ // continue with the awaiting task, if any; spawned tasks just stop here
+    if(auto c = h.promise().continuation)
+        return c;
+    return std::noop_coroutine();
+}
+
+RemoteAPITask RemoteAPITask::promise_type::get_return_object()
+{
+    return RemoteAPITask(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+RemoteAPITask::RemoteAPITask(std::coroutine_handle<promise_type> handle_)
+    : handle(handle_)
+{
+}
+
+RemoteAPITask::RemoteAPITask(RemoteAPITask &&other) noexcept
+    : handle(std::exchange(other.handle, nullptr))
+{
+}
+
+RemoteAPITask & RemoteAPITask::operator=(RemoteAPITask &&other) noexcept
+{
+    if(this != &other)
+    {
+        if(handle)
+            handle.destroy();
+        handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+}
+
+RemoteAPITask::~RemoteAPITask()
+{
+    if(handle)
+        handle.destroy();
+}
+
+bool RemoteAPITask::done() const
+{
+    return !handle || handle.done();
+}
+
+bool RemoteAPITask::await_ready() const noexcept
+{
+    return done();
+}
+
+std::coroutine_handle<> RemoteAPITask::await_suspend(std::coroutine_handle<> awaiting) noexcept
+{ // start (or continue) the awaited task; it resumes the awaiting one when it finishes
+    handle.promise().continuation = awaiting;
+    return handle;
+}
+
+void RemoteAPITask::await_resume() const
+{
+    if(handle && handle.promise().error)
+        std::rethrow_exception(handle.promise().error);
+}
+
+void RemoteAPIEvent::set()
+{
+    RemoteAPIScheduler *scheduler = RemoteAPIScheduler::current();
+    if(!scheduler)
+        throw std::runtime_error("RemoteAPIEvent::set must be called from a RemoteAPIScheduler task");
+    scheduler->ready.insert(scheduler->ready.end(), waiters.begin(), waiters.end());
+    waiters.clear();
+}
+
+RemoteAPIScheduler::RemoteAPIScheduler(RemoteAPIClient &client_)
+    : client(&client_)
+{
+}
+
+void RemoteAPIScheduler::spawn(RemoteAPITask task)
+{
+    if(task.done())
+        return;
+    ready.push_back(task.handle);
+    tasks.push_back(std::move(task));
+}
+
+void RemoteAPIScheduler::run()
+{
+    while(runOnce(true))
+        ;
+}
+
+bool RemoteAPIScheduler::runOnce(bool block)
+{
+    RemoteAPIScheduler *prev = currentScheduler;
+    currentScheduler = this;
+    try
+    {
+        // tasks that become ready meanwhile run in the next round
+        for(size_t n = ready.size(); n > 0 && !ready.empty(); n--)
+        {
+            auto h = ready.front();
+            ready.pop_front();
+            h.resume();
+        }
+
+        // only block on the wire when nothing else could run
+        if(!waiting.empty())
+        {
+            if(client->pendingCount() == 0)
+            { // nothing on the wire can resolve these: let their await_resume report it
+                for(auto &w : waiting)
+                    ready.push_back(w.handle);
+                waiting.clear();
+            }
+            else
+            {
+                // blocks until the earliest deadline of a waiting task at most
+                RemoteAPIClock::time_point deadline = RemoteAPIClock::time_point::min();
+                if(block && ready.empty())
+                {
+                    deadline = RemoteAPIClock::time_point::max();
+                    for(const auto &w : waiting)
+                        deadline = std::min(deadline, w.deadline);
+                }
+                client->pollUntil(deadline);
+
+                const auto now = RemoteAPIClock::now();
+                auto it = std::stable_partition(waiting.begin(), waiting.end(), [now](const auto &w) { return !w.state->done && now < w.deadline; });
+                for(auto i = it; i != waiting.end(); ++i)
+                {
+                    if(!i->state->done)
+                    {
+                        if(i->state->stats)
+                            i->state->stats->timeouts++;
+                        if(i->state->client)
+                            i->state->client->_abandon(*i->state);
+                    }
+                    ready.push_back(i->handle);
+                }
+                waiting.erase(it, waiting.end());
+            }
+        }
+    }
+    catch(...)
+    {
+        currentScheduler = prev;
+        throw;
+    }
+    currentScheduler = prev;
+
+    for(auto it = tasks.begin(); it != tasks.end();)
+    {
+        if(it->done())
+        {
+            RemoteAPITask finished = std::move(*it);
+            it = tasks.erase(it);
+            finished.await_resume(); // rethrows the task's exception
+        }
+        else
+            ++it;
+    }
+    return !tasks.empty();
+}
+
+size_t RemoteAPIScheduler::taskCount() const
+{
+    return tasks.size();
+}
+
+RemoteAPIScheduler::YieldAwaiter RemoteAPIScheduler::yield()
+{
+    return YieldAwaiter{this};
+}
+
+RemoteAPIScheduler * RemoteAPIScheduler::current()
+{
+    return currentScheduler;
+}
+
+void RemoteAPIScheduler::_waitFor(std::shared_ptr<RemoteAPIFuture::State> state, std::coroutine_handle<> h, RemoteAPIClock::time_point deadline)
+{
+    waiting.push_back({std::move(state), h, deadline});
+}
@@ -47,3 +47,105 @@ json sim::callScriptFunction(std::string functionName, int64_t scriptHandle, jso
     auto _ret = this->_client->call("sim.callScriptFunction", _args);
     return _ret;
 }
+
+RemoteAPIClient * sim::getClient()
+{
+    return this->_client;
+}
+
+static json _getVisionSensorImgArgs(int64_t sensorHandle, std::optional<int64_t> options, std::optional<double> rgbaCutOff, std::optional<std::vector<int64_t>> pos, std::optional<std::vector<int64_t>> size)
+{
+    bool _brk = false;
+    json _args(json_array_arg);
+    _args.push_back(sensorHandle);
+    if(options)
+    {
+        if(_brk) throw std::runtime_error("no gaps allowed");
+        else _args.push_back(*options);
+    }
+    else _brk = true;
+    if(rgbaCutOff)
+    {
+        if(_brk) throw std::runtime_error("no gaps allowed");
+        else _args.push_back(*rgbaCutOff);
+    }
+    else _brk = true;
+    if(pos)
+    {
+        if(_brk) throw std::runtime_error("no gaps allowed");
+        else _args.push_back(*pos);
+    }
+    else _brk = true;
+    if(size)
+    {
+        if(_brk) throw std::runtime_error("no gaps allowed");
+        else _args.push_back(*size);
+    }
+    else _brk = true;
+    return _args;
+}
+
+RemoteAPIReply sim::getVisionSensorImgRaw(int64_t sensorHandle, std::optional<int64_t> options, std::optional<double> rgbaCutOff, std::optional<std::vector<int64_t>> pos, std::optional<std::vector<int64_t>> size)
+{ // like getVisionSensorImg, but the image can be viewed in place with bytes(0)
+    return this->_client->callRaw("sim.getVisionSensorImg", _getVisionSensorImgArgs(sensorHandle, options, rgbaCutOff, pos, size));
+}
+
+RemoteAPIFuture sim::getVisionSensorImgAsync(int64_t sensorHandle, std::optional<int64_t> options, std::optional<double> rgbaCutOff, std::optional<std::vector<int64_t>> pos, std::optional<std::vector<int64_t>> size)
+{ // the image can be viewed in place with reply().bytes(0)
+    return this->_client->callAsync("sim.getVisionSensorImg", _getVisionSensorImgArgs(sensorHandle, options, rgbaCutOff, pos, size));
+}
+
+RemoteAPIFuture sim::getObjectPositionAsync(int64_t objectHandle, std::optional<int64_t> relativeToObjectHandle)
+{
+    json _args(json_array_arg);
+    _args.push_back(objectHandle);
+    if(relativeToObjectHandle)
+        _args.push_back(*relativeToObjectHandle);
+    return this->_client->callAsync("sim.getObjectPosition", _args);
+}
+
+RemoteAPIFuture sim::getObjectOrientationAsync(int64_t objectHandle, std::optional<int64_t> relativeToObjectHandle)
+{
+    json _args(json_array_arg);
+    _args.push_back(objectHandle);
+    if(relativeToObjectHandle)
+        _args.push_back(*relativeToObjectHandle);
+    return this->_client->callAsync("sim.getObjectOrientation", _args);
+}
+
+RemoteAPIFuture sim::addForceAndTorqueAsync(int64_t shapeHandle, std::optional<std::vector<double>> force, std::optional<std::vector<double>> torque)
+{
+    bool _brk = false;
+    json _args(json_array_arg);
+    _args.push_back(shapeHandle);
+    if(force)
+    {
+        if(_brk) throw std::runtime_error("no gaps allowed");
+        else _args.push_back(*force);
+    }
+    else _brk = true;
+    if(torque)
+    {
+        if(_brk) throw std::runtime_error("no gaps allowed");
+        else _args.push_back(*torque);
+    }
+    else _brk = true;
+    return this->_client->callAsync("sim.addForceAndTorque", _args);
+}
+
+RemoteAPIFuture sim::callScriptFunctionAsync(std::string functionName, int64_t scriptHandle, json inArgs)
+{
+    json _args(json_array_arg);
+    _args.push_back(functionName);
+    _args.push_back(scriptHandle);
+    if(!inArgs.is_array())
+        throw std::runtime_error("inArgs must be an array");
+    for(const auto& inArg : inArgs.array_range())
+        _args.push_back(inArg);
+    return this->_client->callAsync("sim.callScriptFunction", _args);
+}
+
+RemoteAPIFuture sim::stepAsync()
+{ // sent exclusively, see RemoteAPIClient::setExclusive
+    return this->_client->callAsync("sim.step", json(json_array_arg));
+}
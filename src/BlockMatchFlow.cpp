@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "BlockMatchFlow.h"
+
+namespace
+{
+    // Half-size average of region of image into dst
+    void halve(const cv::Mat& image, const cv::Rect& region, std::vector<std::uint8_t>& dst)
+    {
+        const int width = region.width / 2;
+        const int height = region.height / 2;
+        dst.resize(static_cast<std::size_t>(width) * height);
+        for (int y = 0; y < height; ++y)
+        {
+            const std::uint8_t* row0 = image.ptr<std::uint8_t>(region.y + 2 * y) + region.x;
+            const std::uint8_t* row1 = image.ptr<std::uint8_t>(region.y + 2 * y + 1) + region.x;
+            std::uint8_t* out = dst.data() + static_cast<std::size_t>(y) * width;
+            for (int x = 0; x < width; ++x)
+            {
+                out[x] = static_cast<std::uint8_t>((row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >> 2);
+            }
+        }
+    }
+
+    // Offset of the minimum of the parabola through the costs at -1, 0 and +1
+    float parabolaMinimum(const unsigned before, const unsigned at, const unsigned after)
+    {
+        const double curvature = static_cast<double>(before) - 2.0 * at + after;
+        if (curvature <= 0.0)
+        {
+            return 0.0f;
+        }
+        return static_cast<float>(std::clamp((static_cast<double>(before) - after) / (2.0 * curvature), -0.5, 0.5));
+    }
+}
+
+#if defined(__AVX2__)
+[[nodiscard]] unsigned BlockMatchFlow::sad(const std::uint8_t* a, const std::size_t aStep, const std::uint8_t* b, const std::size_t bStep, const int width, const int rows)
+{
+    __m256i sum = _mm256_setzero_si256();
+    if (width == 32)
+    {
+        for (int y = 0; y < rows; ++y)
+        {
+            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + y * aStep));
+            const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + y * bStep));
+            sum = _mm256_add_epi64(sum, _mm256_sad_epu8(va, vb));
+        }
+    }
+    else
+    {
+        // Two 16-byte rows per register
+        for (int y = 0; y + 1 < rows; y += 2)
+        {
+            const __m256i va = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + y * aStep))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + (y + 1) * aStep)), 1);
+            const __m256i vb = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + y * bStep))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + (y + 1) * bStep)), 1);
+            sum = _mm256_add_epi64(sum, _mm256_sad_epu8(va, vb));
+        }
+    }
+    const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    return static_cast<unsigned>(_mm_cvtsi128_si32(half) + _mm_cvtsi128_si32(_mm_srli_si128(half, 8)));
+}
+#elif defined(__SSE2__) || defined(_M_X64)
+[[nodiscard]] unsigned BlockMatchFlow::sad(const std::uint8_t* a, const std::size_t aStep, const std::uint8_t* b, const std::size_t bStep, const int width, const int rows)
+{
+    __m128i sum = _mm_setzero_si128();
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < width; x += 16)
+        {
+            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + y * aStep + x));
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + y * bStep + x));
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+        }
+    }
+    return static_cast<unsigned>(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+}
+#else
+[[nodiscard]] unsigned BlockMatchFlow::sad(const std::uint8_t* a, const std::size_t aStep, const std::uint8_t* b, const std::size_t bStep, const int width, const int rows)
+{
+    return sadScalar(a, aStep, b, bStep, width, rows);
+}
+#endif
+
+[[nodiscard]] unsigned BlockMatchFlow::sadScalar(const std::uint8_t* a, const std::size_t aStep, const std::uint8_t* b, const std::size_t bStep, const int width, const int rows)
+{
+    unsigned sum = 0;
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            sum += static_cast<unsigned>(std::abs(a[y * aStep + x] - b[y * bStep + x]));
+        }
+    }
+    return sum;
+}
+
+[[nodiscard]] const char* BlockMatchFlow::sadKernel()
+{
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+void BlockMatchFlow::calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, bool)
+{
+    const cv::Point2f translation = estimate(prev, next, cv::Point2f(prev.cols * 0.5f, prev.rows * 0.5f));
+
+    flow.create(prev.size(), CV_32FC2);
+    flow = cv::Scalar(translation.x, translation.y);
+}
+
+void BlockMatchFlow::reset()
+{
+}
+
+[[nodiscard]] cv::Point2f BlockMatchFlow::calcDiscMean(const cv::Mat& prev, const cv::Mat& next, const cv::Point2f centre, int, bool)
+{
+    // The block covers any disc up to s_blockSize / 2 in radius
+    return estimate(prev, next, centre);
+}
+
+[[nodiscard]] cv::Point2f BlockMatchFlow::estimate(const cv::Mat& prev, const cv::Mat& next, const cv::Point2f centre)
+{
+    if (prev.cols < s_blockSize || prev.rows < s_blockSize)
+    {
+        return { 0.0f, 0.0f };
+    }
+
+    // Both levels search only where the block stays inside the image
+    const cv::Rect image(0, 0, prev.cols, prev.rows);
+    const cv::Point block(
+        std::clamp(static_cast<int>(std::lround(centre.x)) - s_blockSize / 2, 0, prev.cols - s_blockSize),
+        std::clamp(static_cast<int>(std::lround(centre.y)) - s_blockSize / 2, 0, prev.rows - s_blockSize));
+
+    // A prediction known to within the refinement radius leaves only the full-resolution search
+    const std::optional<Prediction>& prediction = getPrediction();
+    int fullX = 0;
+    int fullY = 0;
+    if (prediction && prediction->error <= s_refineRadius)
+    {
+        fullX = static_cast<int>(std::lround(prediction->flow.x));
+        fullY = static_cast<int>(std::lround(prediction->flow.y));
+    }
+    else
+    {
+        // Half resolution: a 16x16 block searched over +-s_searchRadius / 2, on an even-aligned crop
+        const cv::Rect crop = cv::Rect(
+            cv::Point((block.x - s_margin) & ~1, (block.y - s_margin) & ~1),
+            cv::Point(block.x + s_blockSize + s_margin, block.y + s_blockSize + s_margin)) & image;
+        const cv::Rect evenCrop(crop.x, crop.y, crop.width & ~1, crop.height & ~1);
+        halve(prev, evenCrop, m_prevHalf);
+        halve(next, evenCrop, m_nextHalf);
+
+        const int halfWidth = evenCrop.width / 2;
+        const int halfHeight = evenCrop.height / 2;
+        const int halfX = (block.x - evenCrop.x) / 2;
+        const int halfY = (block.y - evenCrop.y) / 2;
+        const int halfBlock = s_blockSize / 2;
+        const std::uint8_t* prevBlock = m_prevHalf.data() + static_cast<std::size_t>(halfY) * halfWidth + halfX;
+
+        int bestX = 0;
+        int bestY = 0;
+        unsigned best = UINT_MAX;
+        const int searchHalf = s_searchRadius / 2;
+        for (int dy = std::max(-searchHalf, -halfY); dy <= std::min(searchHalf, halfHeight - halfBlock - halfY); ++dy)
+        {
+            for (int dx = std::max(-searchHalf, -halfX); dx <= std::min(searchHalf, halfWidth - halfBlock - halfX); ++dx)
+            {
+                const std::uint8_t* candidate = m_nextHalf.data() + static_cast<std::size_t>(halfY + dy) * halfWidth + halfX + dx;
+                const unsigned cost = sad(prevBlock, halfWidth, candidate, halfWidth, halfBlock, halfBlock);
+                // Ties go to the smaller displacement
+                if (cost < best || (cost == best && dx * dx + dy * dy < bestX * bestX + bestY * bestY))
+                {
+                    best = cost;
+                    bestX = dx;
+                    bestY = dy;
+                }
+            }
+        }
+        fullX = 2 * bestX;
+        fullY = 2 * bestY;
+    }
+
+    // Full resolution: the 32x32 block around that, one pixel further for the parabolas
+    constexpr int s_costSize = 2 * s_refineRadius + 3;
+    unsigned costs[s_costSize][s_costSize];
+    const std::uint8_t* prevFull = prev.ptr<std::uint8_t>(block.y) + block.x;
+    unsigned best = UINT_MAX;
+    const int centreX = fullX;
+    const int centreY = fullY;
+    for (int j = 0; j < s_costSize; ++j)
+    {
+        for (int i = 0; i < s_costSize; ++i)
+        {
+            const int dx = centreX + i - s_refineRadius - 1;
+            const int dy = centreY + j - s_refineRadius - 1;
+            const bool inside = block.x + dx >= 0 && block.y + dy >= 0
+                && block.x + dx + s_blockSize <= prev.cols && block.y + dy + s_blockSize <= prev.rows;
+            costs[j][i] = inside
+                ? sad(prevFull, prev.step, next.ptr<std::uint8_t>(block.y + dy) + block.x + dx, next.step, s_blockSize, s_blockSize)
+                : UINT_MAX;
+
+            const bool refined = std::abs(i - s_refineRadius - 1) <= s_refineRadius && std::abs(j - s_refineRadius - 1) <= s_refineRadius;
+            if (refined && costs[j][i] < best)
+            {
+                best = costs[j][i];
+                fullX = dx;
+                fullY = dy;
+            }
+        }
+    }
+
+    if (best == UINT_MAX)
+    {
+        return { 0.0f, 0.0f };
+    }
+
+    const int i = fullX - centreX + s_refineRadius + 1;
+    const int j = fullY - centreY + s_refineRadius + 1;
+    const bool fitX = costs[j][i - 1] != UINT_MAX && costs[j][i + 1] != UINT_MAX;
+    const bool fitY = costs[j - 1][i] != UINT_MAX && costs[j + 1][i] != UINT_MAX;
+    return {
+        fullX + (fitX ? parabolaMinimum(costs[j][i - 1], costs[j][i], costs[j][i + 1]) : 0.0f),
+        fullY + (fitY ? parabolaMinimum(costs[j - 1][i], costs[j][i], costs[j + 1][i]) : 0.0f)
+    };
+}
@@ -1,47 +1,94 @@
+#include <algorithm>
+
 #include <opencv4/opencv2/opencv.hpp>
 
 #include "CameraOpticalFlow.h"
+#include "FarnebackFlow.h"
 
-CameraOpticalFlow::CameraOpticalFlow(const Drone& drone) :
-    m_drone{ &drone }
+CameraOpticalFlow::CameraOpticalFlow(const Drone& drone, std::unique_ptr<OpticalFlowEngine> engine) :
+    m_drone{ &drone },
+    m_engine{ engine ? std::move(engine) : std::make_unique<FarnebackFlow>() }
 {
 }
 
 void CameraOpticalFlow::calc(const int x, const int y, const int len)
 {
-    cv::Mat grayFrame = m_drone->getGrayscaleImage();
+    calc(std::make_shared<cv::Mat>(m_drone->getGrayscaleImage()), x, y, len);
+}
+
+void CameraOpticalFlow::calc(FramePool::Frame grayFrame, const int x, const int y, const int len)
+{
+    int x0 = std::max(x - len, 0);
+    int y0 = std::max(y - len, 0);
+    int x1 = std::min(x + len, grayFrame->cols - 1);
+    int y1 = std::min(y + len, grayFrame->rows - 1);
+    calc(std::move(grayFrame), cv::Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1));
+}
 
-    if (m_prevFrame.empty())
+void CameraOpticalFlow::calc(FramePool::Frame grayFrame, const cv::Rect& roi)
+{
+    if (!m_prevFrame)
     {
-        m_prevFrame = grayFrame.clone();
-        m_opticalFlow = cv::Mat::zeros(grayFrame.size(), CV_32FC2);
+        m_opticalFlow = cv::Mat::zeros(grayFrame->size(), CV_32FC2);
+        m_prevFrame = std::move(grayFrame);
         return;
     }
 
-    int x0 = std::max(x - len, 0);
-    int y0 = std::max(y - len, 0);
-    int x1 = std::min(x + len, grayFrame.cols - 1);
-    int y1 = std::min(y + len, grayFrame.rows - 1);
-    cv::Rect roi(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+    // What the engine kept from the last call is of m_prevFrame at m_roi
+    m_engine->setPrediction(std::nullopt);
+    m_engine->calc((*m_prevFrame)(roi), (*grayFrame)(roi), m_flowROI, roi == m_roi);
+    m_roi = roi;
+
+    m_flowROI.copyTo(m_opticalFlow(roi));
+
+    // The frame before goes back to its pool once nothing else holds it
+    m_prevFrame = std::move(grayFrame);
+}
+
+cv::Point2f CameraOpticalFlow::calcDiscMean(FramePool::Frame grayFrame, const cv::Rect& roi, const cv::Point2f centre, const int radius, const std::optional<cv::Point2f>& predictedFlow)
+{
+    if (!m_prevFrame)
+    {
+        m_prevFrame = std::move(grayFrame);
+        return { 0.0f, 0.0f };
+    }
 
-    cv::Mat prevROI = m_prevFrame(roi);
-    cv::Mat currROI = grayFrame(roi);
+    // How far the last prediction missed, doubled as slack, bounds this one's error. That miss is measured
+    // by a flow the bound itself cut down, so it cannot see a larger one: the bound also never drops below
+    // a share of the predicted motion and a floor, and every s_coldStartInterval-th step runs the whole
+    // pyramid without a prediction, measuring the miss independently
+    const bool coldStart = ++m_stepsSinceColdStart >= s_coldStartInterval;
+    if (predictedFlow && !coldStart)
+    {
+        const float error = std::max({ 2.0f * m_predictionError, s_minPredictionError,
+                                       s_motionPredictionError * static_cast<float>(cv::norm(*predictedFlow)) });
+        m_engine->setPrediction(OpticalFlowEngine::Prediction{ *predictedFlow, error });
+    }
+    else
+    {
+        m_engine->setPrediction(std::nullopt);
+        m_stepsSinceColdStart = 0;
+    }
 
-    cv::Mat flowROI;
-    cv::calcOpticalFlowFarneback(
-        prevROI, currROI, flowROI,
-        0.5,   // pyramid scale
-        3,     // levels
-        15,    // window size
-        3,     // iterations
-        5,     // poly_n
-        1.2,   // poly_sigma
-        0      // flags
-    );
+    const cv::Point2f roiCentre(centre.x - roi.x, centre.y - roi.y);
+    const cv::Point2f mean = m_engine->calcDiscMean((*m_prevFrame)(roi), (*grayFrame)(roi), roiCentre, radius, roi == m_roi);
+    m_roi = roi;
+    if (predictedFlow)
+    {
+        m_predictionError = static_cast<float>(cv::norm(mean - *predictedFlow));
+    }
 
-    flowROI.copyTo(m_opticalFlow(roi));
+    m_prevFrame = std::move(grayFrame);
+    return mean;
+}
 
-    m_prevFrame = grayFrame.clone();
+void CameraOpticalFlow::restart(FramePool::Frame grayFrame)
+{
+    m_engine->reset();
+    m_roi = cv::Rect();
+    m_predictionError = std::numeric_limits<float>::infinity();
+    m_stepsSinceColdStart = 0;
+    m_prevFrame = std::move(grayFrame);
 }
 
 cv::Point2f CameraOpticalFlow::getOpticalFlowAt(const int x, const int y) const
@@ -52,3 +99,8 @@ cv::Point2f CameraOpticalFlow::getOpticalFlowAt(const int x, const int y) const
     }
     return m_opticalFlow.at<cv::Point2f>(y, x);
 }
+
+double CameraOpticalFlow::getConfidence() const
+{
+    return m_engine->confidence();
+}
@@ -0,0 +1,45 @@
+#include "DISFlow.h"
+
+namespace
+{
+    int toOpenCVPreset(const DISFlow::Preset preset)
+    {
+        switch (preset)
+        {
+        case DISFlow::Preset::UltraFast:
+            return cv::DISOpticalFlow::PRESET_ULTRAFAST;
+        case DISFlow::Preset::Fast:
+            return cv::DISOpticalFlow::PRESET_FAST;
+        case DISFlow::Preset::Medium:
+            return cv::DISOpticalFlow::PRESET_MEDIUM;
+        }
+        return cv::DISOpticalFlow::PRESET_FAST;
+    }
+}
+
+DISFlow::DISFlow(const Preset preset) :
+    m_dis{ cv::DISOpticalFlow::create(toOpenCVPreset(preset)) }
+{
+}
+
+void DISFlow::calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, const bool reusePrev)
+{
+    // DIS starts from the flow it is given when that has the right size. A prediction is the best start;
+    // without one, the last step's flow over the same pixels is good, but over other pixels it is dropped
+    if (const std::optional<Prediction>& prediction = getPrediction())
+    {
+        flow.create(prev.size(), CV_32FC2);
+        flow = cv::Scalar(prediction->flow.x, prediction->flow.y);
+    }
+    else if (!reusePrev || m_lastSize != prev.size())
+    {
+        flow.release();
+    }
+    m_dis->calc(prev, next, flow);
+    m_lastSize = prev.size();
+}
+
+void DISFlow::reset()
+{
+    m_lastSize = cv::Size();
+}
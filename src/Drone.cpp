@@ -1,12 +1,52 @@
 #include <cmath>
+#include <cstring>
 
 #include "RemoteAPIClient.h"
 
 #include "Drone.h"
+#include "GrayscaleConversion.h"
+
+namespace
+{
+    // Installed into the sandbox script; the stand-in server answers the same calls (see DroneStandInBackend)
+    const char* s_helperCode = R"lua(
+function _droneReadSnapshot(sensor, gyroScript, base, body, propellers, window)
+    local gyro = sim.callScriptFunction('getGyroData', gyroScript)
+    if type(gyro) ~= 'table' then gyro = {0, 0, 0} end
+    local p = sim.getObjectPosition(base)
+    local values = {sim.getSimulationTime(), gyro[1], gyro[2], gyro[3], p[1], p[2], p[3]}
+    for i = 1, #propellers do
+        local o = sim.getObjectOrientation(propellers[i])
+        table.move(o, 1, 3, #values + 1, values)
+    end
+    table.move(sim.getObjectOrientation(body), 1, 3, #values + 1, values)
+    local res = sim.getVisionSensorRes(sensor)
+    if window[3] <= 0 or window[4] <= 0 then window = {0, 0, res[1], res[2]} end
+    -- sensor rows run bottom-up
+    local img = sim.getVisionSensorImg(sensor, 1, 0, {window[1], res[2] - window[2] - window[4]}, {window[3], window[4]})
+    -- one argument list: a call that is not the last argument is cut to its first value
+    local format = '<' .. string.rep('d', #values) .. 'i4i4i4i4'
+    table.move(window, 1, 4, #values + 1, values)
+    return string.pack(format, table.unpack(values)) .. img
+end
+
+function _droneApplyForces(propellers, forces)
+    for i = 1, #propellers do
+        local o = (i - 1) * 6
+        sim.addForceAndTorque(propellers[i], {forces[o + 1], forces[o + 2], forces[o + 3]}, {forces[o + 4], forces[o + 5], forces[o + 6]})
+    end
+end
+)lua";
+
+    // simulation time, gyro data, position, propeller and body orientations, then the window
+    constexpr std::size_t s_snapshotDoubles = 1 + 3 + 3 + 3 * Drone::s_propellersCount + 3;
+    constexpr std::size_t s_snapshotHeaderSize = s_snapshotDoubles * sizeof(double) + 4 * sizeof(std::int32_t);
+}
 
 Drone::Drone(RemoteAPIObject::sim& sim) :
     m_sim{ &sim },
     m_drone{ sim.getObject("/Quadcopter/base/target") },
+    m_body{ sim.getObject("/Quadcopter/base") },
     m_respondables{
         sim.getObject("/Quadcopter/propeller[0]/respondable"),
         sim.getObject("/Quadcopter/propeller[1]/respondable"),
@@ -14,46 +54,235 @@ Drone::Drone(RemoteAPIObject::sim& sim) :
         sim.getObject("/Quadcopter/propeller[3]/respondable")
     },
     m_visionSensor{ sim.getObject("/Quadcopter/visionSensor") },
-    m_gyroSensorScript{ sim.getScript(sim.scripttype_childscript, "/Quadcopter/gyroSensor/Script") }
+    m_gyroSensorScript{ sim.getScript(sim.scripttype_childscript, "/Quadcopter/gyroSensor/Script") },
+    m_helperScript{ sim.getScript(sim.scripttype_sandbox) }
 {
+    sim.executeScriptString(std::string(s_helperCode) + "@lua", m_helperScript);
     std::vector<std::int64_t> cameraFrameSize = std::get<1>(m_sim->getVisionSensorImg(m_visionSensor));
 }
 
 [[nodiscard]] cv::Mat Drone::getGrayscaleImage() const
 {
-    std::vector<std::uint8_t> imgBytes = std::get<0>(m_sim->getVisionSensorImg(m_visionSensor));
-    cv::Mat frame(
-        cameraInfo.resolutionY,
-        cameraInfo.resolutionX,
-        CV_8UC3, imgBytes.data());
-    cv::cvtColor(frame, frame, cv::COLOR_BGR2GRAY);
-    cv::flip(frame, frame, 0);
-    return frame;
+    return getGrayscaleImage(requestGrayscaleImage());
+}
+
+[[nodiscard]] RemoteAPIFuture Drone::requestGrayscaleImage() const
+{
+    return m_sim->getVisionSensorImgAsync(m_visionSensor, 1);
+}
+
+[[nodiscard]] cv::Mat Drone::getGrayscaleImage(const RemoteAPIFuture& request) const
+{
+    // The reply owns the received message; the image is read in place from it
+    return toGrayscaleImage(request.reply().bytes(0));
 }
 
-[[nodiscard]] std::vector<double> Drone::getGyroData() const
+[[nodiscard]] Drone::FrameRequest Drone::requestGrayscaleImage(const cv::Rect& window) const
+{
+    const cv::Rect clipped = window & getFullFrame();
+    if (clipped.empty() || clipped == getFullFrame())
+    {
+        return { m_sim->getVisionSensorImgAsync(m_visionSensor, 1), getFullFrame() };
+    }
+
+    // Sensor rows run bottom-up: the window's bottom row is the sensor's row resolutionY - (y + height)
+    const std::vector<std::int64_t> pos{ clipped.x, cameraInfo.resolutionY - clipped.y - clipped.height };
+    const std::vector<std::int64_t> size{ clipped.width, clipped.height };
+    return { m_sim->getVisionSensorImgAsync(m_visionSensor, 1, 0.0, pos, size), clipped };
+}
+
+[[nodiscard]] cv::Mat Drone::getGrayscaleImage(const FrameRequest& request) const
+{
+    const std::span<const std::uint8_t> imgBytes = request.reply.reply().bytes(0);
+    const std::size_t windowPixels = static_cast<std::size_t>(request.window.width) * request.window.height;
+
+    if (imgBytes.size() == windowPixels || imgBytes.size() == windowPixels * 3)
+    {
+        return toGrayscaleImage(imgBytes, request.window.size());
+    }
+
+    // The sensor ignored the window (e.g. an older simulator): cut it from the full frame
+    return toGrayscaleImage(imgBytes, getFullFrame().size())(request.window).clone();
+}
+
+void Drone::getGrayscaleImage(const FrameRequest& request, cv::Mat& frame) const
+{
+    const std::span<const std::uint8_t> imgBytes = request.reply.reply().bytes(0);
+    const std::size_t windowPixels = static_cast<std::size_t>(request.window.width) * request.window.height;
+
+    if (imgBytes.size() == windowPixels || imgBytes.size() == windowPixels * 3)
+    {
+        cv::Mat window = frame(request.window);
+        toGrayscaleImage(imgBytes, request.window.size(), window);
+        return;
+    }
+
+    // The sensor ignored the window: the whole frame is written
+    toGrayscaleImage(imgBytes, getFullFrame().size(), frame);
+}
+
+[[nodiscard]] cv::Rect Drone::getFullFrame() const
+{
+    return { 0, 0, cameraInfo.resolutionX, cameraInfo.resolutionY };
+}
+
+[[nodiscard]] cv::Mat Drone::toGrayscaleImage(const std::span<const std::uint8_t> imgBytes) const
+{
+    return toGrayscaleImage(imgBytes, getFullFrame().size());
+}
+
+[[nodiscard]] cv::Mat Drone::toGrayscaleImage(const std::span<const std::uint8_t> imgBytes, const cv::Size size)
+{
+    cv::Mat grayFrame;
+    toGrayscaleImage(imgBytes, size, grayFrame);
+    return grayFrame;
+}
+
+void Drone::toGrayscaleImage(const std::span<const std::uint8_t> imgBytes, const cv::Size size, cv::Mat& grayFrame)
+{
+    const std::size_t pixels = static_cast<std::size_t>(size.width) * size.height;
+    if (imgBytes.size() != pixels && imgBytes.size() != pixels * 3)
+    {
+        throw std::runtime_error("Drone::getGrayscaleImage received an image of unexpected size");
+    }
+
+    // Reuses grayFrame's buffer when it already has this size
+    grayFrame.create(size, CV_8UC1);
+
+    if (imgBytes.size() == pixels)
+    {
+        flipGrayscale(imgBytes, size.width, size.height, grayFrame.data, grayFrame.step);
+    }
+    else
+    {
+        convertToFlippedGrayscale(imgBytes, size.width, size.height, grayFrame.data, grayFrame.step);
+    }
+}
+
+[[nodiscard]] std::array<double, 3> Drone::getGyroData() const
+{
+    return getGyroData(requestGyroData());
+}
+
+[[nodiscard]] RemoteAPIFuture Drone::requestGyroData() const
+{
+    return m_sim->callScriptFunctionAsync("getGyroData", m_gyroSensorScript);
+}
+
+[[nodiscard]] std::array<double, 3> Drone::getGyroData(const RemoteAPIFuture& request)
 {
     // gyroData[0] - absolute rotation angle (not velocity) around horizontal forward-backward world axis (roll)
     // gyroData[1] - absolute rotation angle (not velocity) around left-right world axis (pitch)
     // gyroData[2] - absolute rotation angle (not velocity) around vertical world axis (yaw)
 
-    json data = m_sim->callScriptFunction("getGyroData", m_gyroSensorScript)[0];
+    return toGyroData(request.reply().retReader(0));
+}
 
-    if (!data.is_array())
+[[nodiscard]] std::array<double, 3> Drone::toGyroData(RemoteAPICborReader data)
+{
+    if (data.peekMajor() != RemoteAPICborReader::Array)
     {
         return { 0.0, 0.0, 0.0 };
     }
 
-    return {
-        data[0].as<double>(),
-        data[1].as<double>(),
-        data[2].as<double>()
-    };
+    return data.read<std::array<double, 3>>();
 }
 
 [[nodiscard]] double Drone::getAltitude() const
 {
-    return m_sim->getObjectPosition(m_drone)[2];
+    return getAltitude(requestAltitude());
+}
+
+[[nodiscard]] RemoteAPIFuture Drone::requestAltitude() const
+{
+    return m_sim->getObjectPositionAsync(m_drone);
+}
+
+[[nodiscard]] double Drone::getAltitude(const RemoteAPIFuture& request)
+{
+    return request.get<std::array<double, 3>>()[2];
+}
+
+[[nodiscard]] Drone::SensorSnapshot Drone::readSnapshot(const cv::Rect& window) const
+{
+    return getSnapshot(requestSnapshot(window));
+}
+
+[[nodiscard]] RemoteAPIFuture Drone::requestSnapshot(const cv::Rect& window) const
+{
+    const cv::Rect clipped = window & getFullFrame();
+    return m_sim->callScriptFunctionAsync("_droneReadSnapshot", m_helperScript, json(json_array_arg, {
+        m_visionSensor,
+        m_gyroSensorScript,
+        m_drone,
+        m_body,
+        json(json_array_arg, { m_respondables[0], m_respondables[1], m_respondables[2], m_respondables[3] }),
+        json(json_array_arg, { clipped.x, clipped.y, clipped.width, clipped.height })
+    }));
+}
+
+[[nodiscard]] Drone::SensorSnapshot Drone::getSnapshot(const RemoteAPIFuture& request, FramePool::Frame frame) const
+{
+    // Lua strings may arrive as text or byte strings; both are read in place
+    RemoteAPICborReader reader = request.reply().retReader(0);
+    std::span<const std::uint8_t> packed;
+    if (reader.peekMajor() == RemoteAPICborReader::Text)
+    {
+        const std::string_view text = reader.readText();
+        packed = { reinterpret_cast<const std::uint8_t*>(text.data()), text.size() };
+    }
+    else
+    {
+        packed = reader.readBytes();
+    }
+
+    if (packed.size() < s_snapshotHeaderSize)
+    {
+        throw std::runtime_error("Drone::getSnapshot received a truncated snapshot");
+    }
+
+    // Little-endian like every platform this runs on, so the values are copied as they are
+    std::array<double, s_snapshotDoubles> values;
+    std::array<std::int32_t, 4> window;
+    std::memcpy(values.data(), packed.data(), sizeof(values));
+    std::memcpy(window.data(), packed.data() + sizeof(values), sizeof(window));
+
+    SensorSnapshot snapshot;
+    snapshot.simulationTime = values[0];
+    std::copy_n(values.begin() + 1, 3, snapshot.gyroData.begin());
+    std::copy_n(values.begin() + 4, 3, snapshot.position.begin());
+    for (std::uint64_t i = 0; i < s_propellersCount; ++i)
+    {
+        std::copy_n(values.begin() + 7 + 3 * i, 3, snapshot.propellerOrientations[i].begin());
+    }
+    std::copy_n(values.begin() + 7 + 3 * s_propellersCount, 3, snapshot.bodyOrientation.begin());
+    snapshot.window = cv::Rect(window[0], window[1], window[2], window[3]);
+    snapshot.frame = frame ? std::move(frame) : std::make_shared<cv::Mat>(getFullFrame().size(), CV_8UC1);
+    cv::Mat image = (*snapshot.frame)(snapshot.window);
+    toGrayscaleImage(packed.subspan(s_snapshotHeaderSize), snapshot.window.size(), image);
+    return snapshot;
+}
+
+void Drone::addSensorSources(RemoteAPIStream& stream)
+{
+    m_sensorSources.image = stream.addSource("sim.getVisionSensorImg", json(json_array_arg, { m_visionSensor, 1 }), true);
+    m_sensorSources.gyro = stream.addSource("sim.callScriptFunction", json(json_array_arg, { "getGyroData", m_gyroSensorScript }));
+    m_sensorSources.position = stream.addSource("sim.getObjectPosition", json(json_array_arg, { m_drone }));
+}
+
+[[nodiscard]] cv::Mat Drone::getGrayscaleImage(const RemoteAPISnapshot& snapshot) const
+{
+    return toGrayscaleImage(snapshot.bytes(m_sensorSources.image));
+}
+
+[[nodiscard]] std::array<double, 3> Drone::getGyroData(const RemoteAPISnapshot& snapshot) const
+{
+    return toGyroData(snapshot.reader(m_sensorSources.gyro));
+}
+
+[[nodiscard]] double Drone::getAltitude(const RemoteAPISnapshot& snapshot) const
+{
+    return snapshot.reader(m_sensorSources.position).read<std::array<double, 3>>()[2];
 }
 
 void Drone::setAngularVelocities(const std::array<double, s_propellersCount>& angularVelocities)
@@ -63,14 +292,96 @@ void Drone::setAngularVelocities(const std::array<double, s_propellersCount>& an
 
 void Drone::update()
 {
+    if (m_forceMode == ForceMode::Body)
+    {
+        const std::vector<double> bodyAngles = m_sim->getObjectOrientation(m_body);
+        applyBodyForces({ bodyAngles[0], bodyAngles[1], bodyAngles[2] });
+        return;
+    }
+
+    // Get propeller orientations in world frame (one round trip for all propellers)
+    RemoteAPIBatch orientationBatch = m_sim->getClient()->batch();
+    std::array<RemoteAPIFuture, s_propellersCount> orientations;
+    for (std::uint64_t i = 0; i < s_propellersCount; ++i)
+    {
+        orientations[i] = orientationBatch.call("sim.getObjectOrientation", { m_respondables[i] });
+    }
+    orientationBatch.execute();
+
+    std::array<std::array<double, 3>, s_propellersCount> angles;
+    for (std::uint64_t i = 0; i < s_propellersCount; ++i)
+    {
+        angles[i] = orientations[i].get()[0].as<std::array<double, 3>>();
+    }
+    applyForces(angles);
+}
+
+void Drone::update(const SensorSnapshot& snapshot)
+{
+    if (m_forceMode == ForceMode::Body)
+    {
+        applyBodyForces(snapshot.bodyOrientation);
+        return;
+    }
+    applyForces(snapshot.propellerOrientations);
+}
+
+void Drone::setForceMode(const ForceMode mode)
+{
+    m_forceMode = mode;
+}
+
+[[nodiscard]] Drone::PropellerForces Drone::calcPropellerForces(const std::array<double, 3>& bodyAngles) const
+{
+    // rotateForce scales the rotor axis, so scaling it once per propeller gives the same values
+    const std::vector<double> axis = rotateForce({ bodyAngles[0], bodyAngles[1], bodyAngles[2] }, 1.0);
+
+    PropellerForces forces;
+    for (std::uint64_t i = 0; i < s_propellersCount; ++i)
+    {
+        const double thrust = kf * m_angularVelocities[i] * m_angularVelocities[i];
+        const double torqueMag = km * m_angularVelocities[i] * m_angularVelocities[i] * m_propellerDirections[i];
+        for (std::size_t k = 0; k < 3; ++k)
+        {
+            forces.thrust[i][k] = axis[k] * thrust;
+            forces.torque[i][k] = axis[k] * torqueMag;
+        }
+    }
+    return forces;
+}
+
+void Drone::applyBodyForces(const std::array<double, 3>& bodyAngles)
+{
+    const PropellerForces forces = calcPropellerForces(bodyAngles);
+
+    json handles(json_array_arg);
+    json values(json_array_arg);
+    values.reserve(s_propellersCount * 6);
+    for (std::uint64_t i = 0; i < s_propellersCount; ++i)
+    {
+        handles.push_back(m_respondables[i]);
+        for (const double v : forces.thrust[i])
+        {
+            values.push_back(v);
+        }
+        for (const double v : forces.torque[i])
+        {
+            values.push_back(v);
+        }
+    }
+    m_sim->callScriptFunction("_droneApplyForces", m_helperScript, json(json_array_arg, { handles, values }));
+}
+
+void Drone::applyForces(const std::array<std::array<double, 3>, s_propellersCount>& orientations)
+{
+    RemoteAPIBatch forceBatch = m_sim->getClient()->batch();
     for (std::uint64_t i = 0; i < s_propellersCount; ++i)
     {
         // Compute thrust and torque magnitudes
         const double thrust = kf * m_angularVelocities[i] * m_angularVelocities[i];
         const double torqueMag = km * m_angularVelocities[i] * m_angularVelocities[i] * m_propellerDirections[i];
 
-        // Get propeller orientation in world frame
-        std::vector<double> angles = m_sim->getObjectOrientation(m_respondables[i]);
+        const std::vector<double> angles(orientations[i].begin(), orientations[i].end());
 
         // Compute thrust direction in world coordinates
         std::vector<double> thrustVec = rotateForce(angles, thrust);
@@ -79,8 +390,9 @@ void Drone::update()
         std::vector<double> torqueVec = rotateForce(angles, torqueMag);
 
         // Apply both
-        m_sim->addForceAndTorque(m_respondables[i], thrustVec, torqueVec);
+        forceBatch.call("sim.addForceAndTorque", { m_respondables[i], json(thrustVec), json(torqueVec) });
     }
+    forceBatch.execute();
 }
 
 std::vector<double> Drone::rotateForce(const std::vector<double>& angles, const double thrust)
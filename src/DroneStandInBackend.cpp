@@ -0,0 +1,212 @@
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+#include "DroneStandInBackend.h"
+
+namespace
+{
+    // Same rotation as Drone::rotateForce: R = Rz * Ry * Rx
+    std::array<double, 3> rotate(const std::array<double, 3>& angles, const std::array<double, 3>& v)
+    {
+        const double cx = std::cos(angles[0]);
+        const double sx = std::sin(angles[0]);
+        const double cy = std::cos(angles[1]);
+        const double sy = std::sin(angles[1]);
+        const double cz = std::cos(angles[2]);
+        const double sz = std::sin(angles[2]);
+
+        return {
+            cz*cy * v[0] + (cz*sy*sx - sz*cx) * v[1] + (cz*sy*cx + sz*sx) * v[2],
+            sz*cy * v[0] + (sz*sy*sx + cz*cx) * v[1] + (sz*sy*cx - cz*sx) * v[2],
+            -sy * v[0] + cy*sx * v[1] + cy*cx * v[2]
+        };
+    }
+}
+
+DroneStandInBackend::DroneStandInBackend() :
+    m_gyroScript{ scriptHandle(1, "/Quadcopter/gyroSensor/Script") },
+    m_propellers{
+        objectHandle("/Quadcopter/propeller[0]/respondable"),
+        objectHandle("/Quadcopter/propeller[1]/respondable"),
+        objectHandle("/Quadcopter/propeller[2]/respondable"),
+        objectHandle("/Quadcopter/propeller[3]/respondable")
+    }
+{
+    startSimulation();
+}
+
+std::array<double, 3> DroneStandInBackend::position(std::int64_t)
+{
+    return m_position;
+}
+
+std::array<double, 3> DroneStandInBackend::orientation(std::int64_t)
+{
+    return m_angles;
+}
+
+void DroneStandInBackend::addForceAndTorque(const std::int64_t handle, const std::array<double, 3>& force, const std::array<double, 3>& torque)
+{
+    // Propellers sit at the ends of the arms, so their thrust also tilts the body
+    std::array<double, 3> arm{};
+    for (std::size_t i = 0; i < m_propellers.size(); ++i)
+    {
+        if (m_propellers[i] == handle)
+        {
+            const double a = std::numbers::pi / 4 + i * std::numbers::pi / 2;
+            arm = rotate(m_angles, { m_armLength * std::cos(a), m_armLength * std::sin(a), 0.0 });
+        }
+    }
+
+    for (std::size_t k = 0; k < 3; ++k)
+    {
+        m_force[k] += force[k];
+        m_torque[k] += torque[k] + arm[(k + 1) % 3] * force[(k + 2) % 3] - arm[(k + 2) % 3] * force[(k + 1) % 3];
+    }
+}
+
+void DroneStandInBackend::visionSensorImage(std::int64_t, std::vector<std::uint8_t>& rgb, std::int64_t& resX, std::int64_t& resY)
+{
+    // Pinhole camera looking down the body's -z axis, rows bottom-up like CoppeliaSim
+    resX = m_resolution;
+    resY = m_resolution;
+    rgb.resize(static_cast<std::size_t>(m_resolution) * m_resolution * 3);
+
+    const double focalLength = m_resolution / (std::tan(m_fov / 2) * 2);
+    const double center = m_resolution / 2.0;
+    const std::array<double, 3> dx = rotate(m_angles, { 1.0 / focalLength, 0.0, 0.0 });
+    const std::array<double, 3> dy = rotate(m_angles, { 0.0, 1.0 / focalLength, 0.0 });
+    const std::array<double, 3> down = rotate(m_angles, { 0.0, 0.0, -1.0 });
+
+    std::uint8_t* pixel = rgb.data();
+    for (int row = 0; row < m_resolution; ++row)
+    {
+        for (int col = 0; col < m_resolution; ++col, pixel += 3)
+        {
+            const double u = col - center;
+            const double v = row - center;
+            const double rayZ = down[2] + dx[2] * u + dy[2] * v;
+
+            std::uint8_t value = 200; // sky
+            if (rayZ < 0.0)
+            {
+                const double t = -m_position[2] / rayZ;
+                const double x = m_position[0] + t * (down[0] + dx[0] * u + dy[0] * v);
+                const double y = m_position[1] + t * (down[1] + dx[1] * u + dy[1] * v);
+                value = static_cast<std::uint8_t>(groundTexture(x, y));
+            }
+            pixel[0] = value;
+            pixel[1] = value;
+            pixel[2] = value;
+        }
+    }
+}
+
+json DroneStandInBackend::callScriptFunction(const std::string& func, const std::int64_t script, const json& args)
+{
+    if (script == m_gyroScript && func == "getGyroData")
+    {
+        return json(json_array_arg, { json(json_array_arg, { m_angles[0], m_angles[1], m_angles[2] }) });
+    }
+    if (func == "_droneReadSnapshot")
+    {
+        return readSnapshot(args);
+    }
+    if (func == "_droneApplyForces")
+    {
+        const json& forces = args[1];
+        for (std::size_t i = 0; i < args[0].size(); ++i)
+        {
+            addForceAndTorque(args[0][i].as<std::int64_t>(),
+                { forces[6 * i].as<double>(), forces[6 * i + 1].as<double>(), forces[6 * i + 2].as<double>() },
+                { forces[6 * i + 3].as<double>(), forces[6 * i + 4].as<double>(), forces[6 * i + 5].as<double>() });
+        }
+        return json(json_array_arg);
+    }
+    return RemoteAPIStandInBackend::callScriptFunction(func, script, args);
+}
+
+json DroneStandInBackend::readSnapshot(const json& args)
+{
+    // Same packing as the Lua helper in Drone.cpp
+    std::vector<double> values{ simulationTime() };
+    const json gyro = callScriptFunction("getGyroData", args[1].as<std::int64_t>(), json(json_array_arg))[0];
+    const std::array<double, 3> basePosition = position(args[2].as<std::int64_t>());
+    for (std::size_t k = 0; k < 3; ++k)
+    {
+        values.push_back(gyro[k].as<double>());
+    }
+    values.insert(values.end(), basePosition.begin(), basePosition.end());
+    for (const auto& propeller : args[4].array_range())
+    {
+        const std::array<double, 3> angles = orientation(propeller.as<std::int64_t>());
+        values.insert(values.end(), angles.begin(), angles.end());
+    }
+    const std::array<double, 3> bodyAngles = orientation(args[3].as<std::int64_t>());
+    values.insert(values.end(), bodyAngles.begin(), bodyAngles.end());
+
+    std::array<std::int32_t, 4> window{};
+    for (std::size_t k = 0; k < 4; ++k)
+    {
+        window[k] = args[5][k].as<std::int32_t>();
+    }
+    if (window[2] <= 0 || window[3] <= 0)
+    {
+        window = { 0, 0, m_resolution, m_resolution };
+    }
+    std::int64_t resX = window[2];
+    std::int64_t resY = window[3];
+    visionSensorWindow(args[0].as<std::int64_t>(), true, window[0], m_resolution - window[1] - window[3], resX, resY, m_window);
+
+    std::vector<std::uint8_t> packed(values.size() * sizeof(double) + sizeof(window) + m_window.size());
+    std::memcpy(packed.data(), values.data(), values.size() * sizeof(double));
+    std::memcpy(packed.data() + values.size() * sizeof(double), window.data(), sizeof(window));
+    std::memcpy(packed.data() + values.size() * sizeof(double) + sizeof(window), m_window.data(), m_window.size());
+    return json(json_array_arg, { json(byte_string_arg, packed) });
+}
+
+void DroneStandInBackend::startSimulation()
+{
+    RemoteAPIStandInBackend::startSimulation();
+    m_position = { 0.0, 0.0, 1.0 };
+    m_velocity = {};
+    m_angles = {};
+    m_angularVelocity = {};
+    m_force = {};
+    m_torque = {};
+}
+
+void DroneStandInBackend::step()
+{
+    RemoteAPIStandInBackend::step();
+
+    // Forces and torques only act during the step they were added for
+    m_force[2] -= m_mass * 9.81;
+    for (std::size_t k = 0; k < 3; ++k)
+    {
+        m_velocity[k] += m_force[k] / m_mass * dt;
+        m_position[k] += m_velocity[k] * dt;
+        m_angularVelocity[k] += m_torque[k] / m_inertia * dt;
+        m_angles[k] += m_angularVelocity[k] * dt;
+    }
+
+    if (m_position[2] < 0.02)
+    {
+        m_position[2] = 0.02;
+        m_velocity = {};
+        m_angularVelocity = {};
+    }
+
+    m_force = {};
+    m_torque = {};
+}
+
+double DroneStandInBackend::groundTexture(const double x, const double y)
+{
+    // Smooth, non-repeating pattern so that dense optical flow has gradients everywhere
+    return 128.0
+        + 45.0 * std::sin(3.1 * x) * std::cos(2.3 * y)
+        + 30.0 * std::sin(7.7 * x + 5.3 * y)
+        + 20.0 * std::cos(13.1 * y - 4.1 * x);
+}
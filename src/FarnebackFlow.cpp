@@ -0,0 +1,457 @@
+// The polynomial expansion and flow update below are ported from OpenCV's modules/video/src/optflowgf.cpp,
+// which is distributed under the following license:
+//
+//                           License Agreement
+//                For Open Source Computer Vision Library
+//                        (3-clause BSD License)
+//
+// Copyright (C) 2000-2008, Intel Corporation, all rights reserved.
+// Copyright (C) 2009, Willow Garage Inc., all rights reserved.
+// Third party copyrights are property of their respective owners.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//   * Redistribution's of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//
+//   * Redistribution's in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//   * The name of the copyright holders may not be used to endorse or promote products
+//     derived from this software without specific prior written permission.
+//
+// This software is provided by the copyright holders and contributors "as is" and
+// any express or implied warranties, including, but not limited to, the implied
+// warranties of merchantability and fitness for a particular purpose are disclaimed.
+// In no event shall the Intel Corporation or contributors be liable for any direct,
+// indirect, incidental, special, exemplary, or consequential damages
+// (including, but not limited to, procurement of substitute goods or services;
+// loss of use, data, or profits; or business interruption) however caused
+// and on any theory of liability, whether in contract, strict liability,
+// or tort (including negligence or otherwise) arising in any way out of
+// the use of this software, even if advised of the possibility of such damage.
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+#include "FarnebackFlow.h"
+
+namespace
+{
+    // Coarser levels than this are not built
+    constexpr int s_minLevelSize = 32;
+
+    // Gaussian weights g, x * g and x^2 * g over [-n, n] (pointers at 0), and the entries of the
+    // inverse applicability matrix that the expansion needs
+    void prepareGaussian(const int n, double sigma, float* g, float* xg, float* xxg, double& ig11, double& ig03, double& ig33, double& ig55)
+    {
+        if (sigma < FLT_EPSILON)
+        {
+            sigma = n * 0.3;
+        }
+
+        double sum = 0.0;
+        for (int x = -n; x <= n; ++x)
+        {
+            g[x] = static_cast<float>(std::exp(-x * x / (2 * sigma * sigma)));
+            sum += g[x];
+        }
+
+        sum = 1.0 / sum;
+        for (int x = -n; x <= n; ++x)
+        {
+            g[x] = static_cast<float>(g[x] * sum);
+            xg[x] = static_cast<float>(x * g[x]);
+            xxg[x] = static_cast<float>(x * x * g[x]);
+        }
+
+        cv::Mat G = cv::Mat::zeros(6, 6, CV_64F);
+        for (int y = -n; y <= n; ++y)
+        {
+            for (int x = -n; x <= n; ++x)
+            {
+                G.at<double>(0, 0) += g[y] * g[x];
+                G.at<double>(1, 1) += g[y] * g[x] * x * x;
+                G.at<double>(3, 3) += g[y] * g[x] * x * x * x * x;
+                G.at<double>(5, 5) += g[y] * g[x] * x * x * y * y;
+            }
+        }
+
+        G.at<double>(2, 2) = G.at<double>(0, 3) = G.at<double>(0, 4) = G.at<double>(3, 0) = G.at<double>(4, 0) = G.at<double>(1, 1);
+        G.at<double>(4, 4) = G.at<double>(3, 3);
+        G.at<double>(3, 4) = G.at<double>(4, 3) = G.at<double>(5, 5);
+
+        const cv::Mat invG = G.inv(cv::DECOMP_CHOLESKY);
+        ig11 = invG.at<double>(1, 1);
+        ig03 = invG.at<double>(0, 3);
+        ig33 = invG.at<double>(3, 3);
+        ig55 = invG.at<double>(5, 5);
+    }
+
+    // Quadratic polynomial fitted around every pixel of src (CV_32FC1); dst holds its five
+    // non-constant coefficients per pixel (CV_32FC(5))
+    void polyExp(const cv::Mat& src, cv::Mat& dst, const int n, const double sigma)
+    {
+        const int width = src.cols;
+        const int height = src.rows;
+        std::vector<float> kernel(n * 6 + 3);
+        std::vector<float> rowBuffer((width + n * 2) * 3);
+        float* g = kernel.data() + n;
+        float* xg = g + n * 2 + 1;
+        float* xxg = xg + n * 2 + 1;
+        float* row = rowBuffer.data() + n * 3;
+        double ig11, ig03, ig33, ig55;
+
+        prepareGaussian(n, sigma, g, xg, xxg, ig11, ig03, ig33, ig55);
+
+        dst.create(height, width, CV_32FC(5));
+
+        for (int y = 0; y < height; ++y)
+        {
+            const float* srow0 = src.ptr<float>(y);
+            float* drow = dst.ptr<float>(y);
+
+            // Vertical part of the convolution
+            for (int x = 0; x < width; ++x)
+            {
+                row[x * 3] = srow0[x] * g[0];
+                row[x * 3 + 1] = row[x * 3 + 2] = 0.0f;
+            }
+
+            for (int k = 1; k <= n; ++k)
+            {
+                srow0 = src.ptr<float>(std::max(y - k, 0));
+                const float* srow1 = src.ptr<float>(std::min(y + k, height - 1));
+
+                for (int x = 0; x < width; ++x)
+                {
+                    const float p = srow0[x] + srow1[x];
+                    row[x * 3] += g[k] * p;
+                    row[x * 3 + 1] += xg[k] * (srow1[x] - srow0[x]);
+                    row[x * 3 + 2] += xxg[k] * p;
+                }
+            }
+
+            // Horizontal part, with the borders replicated
+            for (int x = 0; x < n * 3; ++x)
+            {
+                row[-1 - x] = row[2 - x];
+                row[width * 3 + x] = row[width * 3 + x - 3];
+            }
+
+            for (int x = 0; x < width; ++x)
+            {
+                // b1 ~ 1, b2 ~ x, b3 ~ y, b4 ~ x^2, b5 ~ y^2, b6 ~ xy
+                double b1 = row[x * 3] * g[0];
+                double b2 = 0.0;
+                double b3 = row[x * 3 + 1] * g[0];
+                double b4 = 0.0;
+                double b5 = row[x * 3 + 2] * g[0];
+                double b6 = 0.0;
+
+                for (int k = 1; k <= n; ++k)
+                {
+                    const double tg = row[(x + k) * 3] + row[(x - k) * 3];
+                    b1 += tg * g[k];
+                    b4 += tg * xxg[k];
+                    b2 += (row[(x + k) * 3] - row[(x - k) * 3]) * xg[k];
+                    b3 += (row[(x + k) * 3 + 1] + row[(x - k) * 3 + 1]) * g[k];
+                    b6 += (row[(x + k) * 3 + 1] - row[(x - k) * 3 + 1]) * xg[k];
+                    b5 += (row[(x + k) * 3 + 2] + row[(x - k) * 3 + 2]) * g[k];
+                }
+
+                drow[x * 5 + 1] = static_cast<float>(b2 * ig11);
+                drow[x * 5] = static_cast<float>(b3 * ig11);
+                drow[x * 5 + 3] = static_cast<float>(b1 * ig03 + b4 * ig33);
+                drow[x * 5 + 2] = static_cast<float>(b1 * ig03 + b5 * ig33);
+                drow[x * 5 + 4] = static_cast<float>(b6 * ig55);
+            }
+        }
+    }
+
+    // Per-pixel normal equations of the displacement for rows [y0, y1), from both expansions
+    // compared at the current flow
+    void updateMatrices(const cv::Mat& R0, const cv::Mat& R1, const cv::Mat& flowField, cv::Mat& matM, const int y0, const int y1)
+    {
+        constexpr int s_border = 5;
+        static const float s_borderWeights[s_border] = { 0.14f, 0.14f, 0.4472f, 0.4472f, 0.4472f };
+
+        const int width = flowField.cols;
+        const int height = flowField.rows;
+        const float* r1 = R1.ptr<float>();
+        const std::size_t step1 = R1.step / sizeof(r1[0]);
+
+        matM.create(height, width, CV_32FC(5));
+
+        for (int y = y0; y < y1; ++y)
+        {
+            const float* flow = flowField.ptr<float>(y);
+            const float* r0 = R0.ptr<float>(y);
+            float* M = matM.ptr<float>(y);
+
+            for (int x = 0; x < width; ++x)
+            {
+                const float dx = flow[x * 2];
+                const float dy = flow[x * 2 + 1];
+                float fx = x + dx;
+                float fy = y + dy;
+
+                const int x1 = cvFloor(fx);
+                const int y1 = cvFloor(fy);
+                float r2, r3, r4, r5, r6;
+
+                fx -= x1;
+                fy -= y1;
+
+                if (static_cast<unsigned>(x1) < static_cast<unsigned>(width - 1)
+                    && static_cast<unsigned>(y1) < static_cast<unsigned>(height - 1))
+                {
+                    const float* ptr = r1 + y1 * step1 + x1 * 5;
+                    const float a00 = (1.0f - fx) * (1.0f - fy);
+                    const float a01 = fx * (1.0f - fy);
+                    const float a10 = (1.0f - fx) * fy;
+                    const float a11 = fx * fy;
+
+                    r2 = a00 * ptr[0] + a01 * ptr[5] + a10 * ptr[step1] + a11 * ptr[step1 + 5];
+                    r3 = a00 * ptr[1] + a01 * ptr[6] + a10 * ptr[step1 + 1] + a11 * ptr[step1 + 6];
+                    r4 = a00 * ptr[2] + a01 * ptr[7] + a10 * ptr[step1 + 2] + a11 * ptr[step1 + 7];
+                    r5 = a00 * ptr[3] + a01 * ptr[8] + a10 * ptr[step1 + 3] + a11 * ptr[step1 + 8];
+                    r6 = a00 * ptr[4] + a01 * ptr[9] + a10 * ptr[step1 + 4] + a11 * ptr[step1 + 9];
+
+                    r4 = (r0[x * 5 + 2] + r4) * 0.5f;
+                    r5 = (r0[x * 5 + 3] + r5) * 0.5f;
+                    r6 = (r0[x * 5 + 4] + r6) * 0.25f;
+                }
+                else
+                {
+                    r2 = r3 = 0.0f;
+                    r4 = r0[x * 5 + 2];
+                    r5 = r0[x * 5 + 3];
+                    r6 = r0[x * 5 + 4] * 0.5f;
+                }
+
+                r2 = (r0[x * 5] - r2) * 0.5f;
+                r3 = (r0[x * 5 + 1] - r3) * 0.5f;
+
+                r2 += r4 * dy + r6 * dx;
+                r3 += r6 * dy + r5 * dx;
+
+                if (static_cast<unsigned>(x - s_border) >= static_cast<unsigned>(width - s_border * 2)
+                    || static_cast<unsigned>(y - s_border) >= static_cast<unsigned>(height - s_border * 2))
+                {
+                    const float scale = (x < s_border ? s_borderWeights[x] : 1.0f)
+                        * (x >= width - s_border ? s_borderWeights[width - x - 1] : 1.0f)
+                        * (y < s_border ? s_borderWeights[y] : 1.0f)
+                        * (y >= height - s_border ? s_borderWeights[height - y - 1] : 1.0f);
+
+                    r2 *= scale;
+                    r3 *= scale;
+                    r4 *= scale;
+                    r5 *= scale;
+                    r6 *= scale;
+                }
+
+                M[x * 5] = r4 * r4 + r6 * r6;
+                M[x * 5 + 1] = (r4 + r5) * r6;
+                M[x * 5 + 2] = r5 * r5 + r6 * r6;
+                M[x * 5 + 3] = r4 * r2 + r6 * r3;
+                M[x * 5 + 4] = r6 * r2 + r5 * r3;
+            }
+        }
+    }
+
+    // Solves the box-filtered normal equations for the flow; with updateMatrices, refreshes them
+    // for the next iteration a stripe behind the rows already solved
+    void updateFlowBlur(const cv::Mat& R0, const cv::Mat& R1, cv::Mat& flowField, cv::Mat& matM, const int blockSize, const bool refreshMatrices)
+    {
+        const int width = flowField.cols;
+        const int height = flowField.rows;
+        const int m = blockSize / 2;
+        const int minUpdateStripe = std::max((1 << 10) / width, blockSize);
+        const double scale = 1.0 / (blockSize * blockSize);
+        int y0 = 0;
+
+        std::vector<double> vsumBuffer((width + m * 2 + 2) * 5);
+        double* vsum = vsumBuffer.data() + (m + 1) * 5;
+
+        const float* srow0 = matM.ptr<float>();
+        for (int x = 0; x < width * 5; ++x)
+        {
+            vsum[x] = srow0[x] * (m + 2);
+        }
+
+        for (int y = 1; y < m; ++y)
+        {
+            srow0 = matM.ptr<float>(std::min(y, height - 1));
+            for (int x = 0; x < width * 5; ++x)
+            {
+                vsum[x] += srow0[x];
+            }
+        }
+
+        for (int y = 0; y < height; ++y)
+        {
+            float* flow = flowField.ptr<float>(y);
+
+            srow0 = matM.ptr<float>(std::max(y - m - 1, 0));
+            const float* srow1 = matM.ptr<float>(std::min(y + m, height - 1));
+
+            // Vertical running sum
+            for (int x = 0; x < width * 5; ++x)
+            {
+                vsum[x] += srow1[x] - srow0[x];
+            }
+
+            for (int x = 0; x < (m + 1) * 5; ++x)
+            {
+                vsum[-1 - x] = vsum[4 - x];
+                vsum[width * 5 + x] = vsum[width * 5 + x - 5];
+            }
+
+            double g11 = vsum[0] * (m + 2);
+            double g12 = vsum[1] * (m + 2);
+            double g22 = vsum[2] * (m + 2);
+            double h1 = vsum[3] * (m + 2);
+            double h2 = vsum[4] * (m + 2);
+
+            for (int x = 1; x < m; ++x)
+            {
+                g11 += vsum[x * 5];
+                g12 += vsum[x * 5 + 1];
+                g22 += vsum[x * 5 + 2];
+                h1 += vsum[x * 5 + 3];
+                h2 += vsum[x * 5 + 4];
+            }
+
+            // Horizontal running sum and the 2x2 solve
+            for (int x = 0; x < width; ++x)
+            {
+                g11 += vsum[(x + m) * 5] - vsum[(x - m) * 5 - 5];
+                g12 += vsum[(x + m) * 5 + 1] - vsum[(x - m) * 5 - 4];
+                g22 += vsum[(x + m) * 5 + 2] - vsum[(x - m) * 5 - 3];
+                h1 += vsum[(x + m) * 5 + 3] - vsum[(x - m) * 5 - 2];
+                h2 += vsum[(x + m) * 5 + 4] - vsum[(x - m) * 5 - 1];
+
+                const double sg11 = g11 * scale;
+                const double sg12 = g12 * scale;
+                const double sg22 = g22 * scale;
+                const double sh1 = h1 * scale;
+                const double sh2 = h2 * scale;
+
+                const double idet = 1.0 / (sg11 * sg22 - sg12 * sg12 + 1e-3);
+
+                flow[x * 2] = static_cast<float>((sg11 * sh2 - sg12 * sh1) * idet);
+                flow[x * 2 + 1] = static_cast<float>((sg22 * sh1 - sg12 * sh2) * idet);
+            }
+
+            const int y1 = y == height - 1 ? height : y - blockSize;
+            if (refreshMatrices && (y1 == height || y1 >= y0 + minUpdateStripe))
+            {
+                updateMatrices(R0, R1, flowField, matM, y0, y1);
+                y0 = y1;
+            }
+        }
+    }
+}
+
+FarnebackFlow::FarnebackFlow() :
+    FarnebackFlow(Params())
+{
+}
+
+FarnebackFlow::FarnebackFlow(const Params& params) :
+    m_params{ params }
+{
+}
+
+void FarnebackFlow::calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, const bool reusePrev)
+{
+    int levels = 0;
+    double scale = 1.0;
+    for (; levels < m_params.levels; ++levels)
+    {
+        scale *= m_params.pyrScale;
+        if (prev.cols * scale < s_minLevelSize || prev.rows * scale < s_minLevelSize)
+        {
+            break;
+        }
+    }
+
+    // Like OPTFLOW_USE_INITIAL_FLOW with a uniform field: a prediction starts the coarsest level solved,
+    // and the levels above the ones its error needs are neither expanded nor solved
+    const std::optional<Prediction>& prediction = getPrediction();
+    const int firstLevel = prediction ? levelsFor(prediction->error, m_params.pyrScale, levels) : levels;
+
+    if (reusePrev && m_cachedSize == prev.size() && m_nextExpansions.size() > static_cast<std::size_t>(firstLevel))
+    {
+        std::swap(m_prevExpansions, m_nextExpansions);
+    }
+    else
+    {
+        expand(prev, firstLevel, m_prevExpansions);
+    }
+    // Into the buffers of the expansion just dropped
+    expand(next, firstLevel, m_nextExpansions);
+    m_cachedSize = next.size();
+
+    for (int k = firstLevel; k >= 0; --k)
+    {
+        const cv::Size size = m_prevExpansions[k].size();
+        cv::Mat& levelFlow = k > 0 ? m_levelFlow : flow;
+
+        if (k == firstLevel)
+        {
+            levelFlow.create(size, CV_32FC2);
+            const cv::Point2f initialFlow = prediction ? prediction->flow * std::pow(m_params.pyrScale, k) : cv::Point2f(0.0f, 0.0f);
+            levelFlow = cv::Scalar(initialFlow.x, initialFlow.y);
+        }
+        else
+        {
+            cv::resize(m_prevFlow, levelFlow, size, 0, 0, cv::INTER_LINEAR);
+            levelFlow *= 1.0 / m_params.pyrScale;
+        }
+
+        updateMatrices(m_prevExpansions[k], m_nextExpansions[k], levelFlow, m_matrices, 0, levelFlow.rows);
+
+        for (int i = 0; i < m_params.iterations; ++i)
+        {
+            updateFlowBlur(m_prevExpansions[k], m_nextExpansions[k], levelFlow, m_matrices, m_params.winSize, i < m_params.iterations - 1);
+        }
+
+        if (k > 0)
+        {
+            std::swap(m_prevFlow, m_levelFlow);
+        }
+    }
+}
+
+void FarnebackFlow::reset()
+{
+    m_nextExpansions.clear();
+    m_cachedSize = cv::Size();
+}
+
+void FarnebackFlow::expand(const cv::Mat& image, const int levels, std::vector<cv::Mat>& expansions)
+{
+    expansions.resize(levels + 1);
+    image.convertTo(m_image, CV_32F);
+
+    double scale = 1.0;
+    for (int k = 0; k <= levels; ++k)
+    {
+        // Smoothed in proportion to the level's downscaling before sampling it down
+        const double sigma = (1.0 / scale - 1.0) * 0.5;
+        const int smoothSize = std::max(cvRound(sigma * 5) | 1, 3);
+        const cv::Size size(cvRound(image.cols * scale), cvRound(image.rows * scale));
+
+        cv::GaussianBlur(m_image, m_blurred, cv::Size(smoothSize, smoothSize), sigma, sigma);
+        cv::resize(m_blurred, m_levelImage, size, 0, 0, cv::INTER_LINEAR);
+        polyExp(m_levelImage, expansions[k], m_params.polyN, m_params.polySigma);
+
+        scale *= m_params.pyrScale;
+    }
+}
@@ -0,0 +1,42 @@
+#include <stdexcept>
+
+#include "FramePool.h"
+
+FramePool::FramePool(const cv::Size size, const int type, const std::size_t count)
+{
+    if (count == 0)
+    {
+        throw std::runtime_error("FramePool needs at least one frame");
+    }
+
+    m_frames.reserve(count);
+    m_free.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        m_frames.emplace_back(size, type);
+        m_free.push_back(&m_frames.back());
+    }
+}
+
+[[nodiscard]] FramePool::Frame FramePool::acquire()
+{
+    if (m_free.empty())
+    {
+        ++m_overflows;
+        return std::make_shared<cv::Mat>(m_frames.front().size(), m_frames.front().type());
+    }
+
+    cv::Mat* frame = m_free.back();
+    m_free.pop_back();
+    return Frame(frame, [this](cv::Mat* released) { m_free.push_back(released); });
+}
+
+[[nodiscard]] std::size_t FramePool::available() const
+{
+    return m_free.size();
+}
+
+[[nodiscard]] std::uint64_t FramePool::overflows() const
+{
+    return m_overflows;
+}
@@ -0,0 +1,158 @@
+#include <cstring>
+
+// MSVC has no SSSE3 switch: there the DRONE_SSSE3 build option defines DRONE_SSSE3 in place of __SSSE3__
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__) || defined(DRONE_SSSE3)
+#include <tmmintrin.h>
+#endif
+
+#include "GrayscaleConversion.h"
+
+namespace
+{
+    // Fixed-point weights and rounding of OpenCV's 8-bit BGR2GRAY (15 fractional bits, summing to one; the
+    // 14-bit weights of its YUV conversions round differently)
+    constexpr int s_shift = 15;
+    constexpr int s_blueWeight = 3735;
+    constexpr int s_greenWeight = 19235;
+    constexpr int s_redWeight = 9798;
+    constexpr int s_round = 1 << (s_shift - 1);
+
+    inline std::uint8_t toGray(const std::uint8_t* pixel)
+    {
+        return static_cast<std::uint8_t>((pixel[0] * s_blueWeight + pixel[1] * s_greenWeight + pixel[2] * s_redWeight + s_round) >> s_shift);
+    }
+
+#if defined(__AVX2__) || defined(__SSSE3__) || defined(DRONE_SSSE3)
+    // Splits 16 interleaved pixels (48 bytes) into their three channels
+    inline void deinterleave16(const std::uint8_t* src, __m128i& b, __m128i& g, __m128i& r)
+    {
+        const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+        const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+
+        // Channel c of pixel i sits at byte 3 * i + c; -1 (0x80) zeroes a byte
+        b = _mm_or_si128(_mm_or_si128(
+                _mm_shuffle_epi8(v0, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+                _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1))),
+                _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13)));
+        g = _mm_or_si128(_mm_or_si128(
+                _mm_shuffle_epi8(v0, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+                _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1))),
+                _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14)));
+        r = _mm_or_si128(_mm_or_si128(
+                _mm_shuffle_epi8(v0, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+                _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1))),
+                _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15)));
+    }
+#endif
+
+#if defined(__AVX2__)
+    // b * wb + g * wg and r * wr + round as pairwise multiply-adds of 16-bit lanes into 32-bit sums
+    inline void convertRow(const std::uint8_t* src, std::uint8_t* dst, const int width)
+    {
+        const __m256i blueGreen = _mm256_set1_epi32((s_greenWeight << 16) | s_blueWeight);
+        const __m256i redRound = _mm256_set1_epi32((1 << 16) | s_redWeight);
+        const __m256i round = _mm256_set1_epi16(static_cast<short>(s_round));
+
+        int x = 0;
+        for (; x + 16 <= width; x += 16)
+        {
+            __m128i b, g, r;
+            deinterleave16(src + 3 * x, b, g, r);
+            const __m256i b16 = _mm256_cvtepu8_epi16(b);
+            const __m256i g16 = _mm256_cvtepu8_epi16(g);
+            const __m256i r16 = _mm256_cvtepu8_epi16(r);
+
+            // Lane-wise unpacking: lo holds pixels 0-3 and 8-11, hi 4-7 and 12-15
+            const __m256i lo = _mm256_srli_epi32(_mm256_add_epi32(
+                _mm256_madd_epi16(_mm256_unpacklo_epi16(b16, g16), blueGreen),
+                _mm256_madd_epi16(_mm256_unpacklo_epi16(r16, round), redRound)), s_shift);
+            const __m256i hi = _mm256_srli_epi32(_mm256_add_epi32(
+                _mm256_madd_epi16(_mm256_unpackhi_epi16(b16, g16), blueGreen),
+                _mm256_madd_epi16(_mm256_unpackhi_epi16(r16, round), redRound)), s_shift);
+
+            // packs restores the pixel order within each lane; the permute joins both lanes' low halves
+            const __m256i gray = _mm256_packus_epi16(_mm256_packs_epi32(lo, hi), _mm256_setzero_si256());
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x),
+                _mm256_castsi256_si128(_mm256_permute4x64_epi64(gray, 0b1000)));
+        }
+        for (; x < width; ++x)
+        {
+            dst[x] = toGray(src + 3 * x);
+        }
+    }
+#elif defined(__SSSE3__) || defined(DRONE_SSSE3)
+    inline void convertRow(const std::uint8_t* src, std::uint8_t* dst, const int width)
+    {
+        const __m128i blueGreen = _mm_set1_epi32((s_greenWeight << 16) | s_blueWeight);
+        const __m128i redRound = _mm_set1_epi32((1 << 16) | s_redWeight);
+        const __m128i round = _mm_set1_epi16(static_cast<short>(s_round));
+        const __m128i zero = _mm_setzero_si128();
+
+        int x = 0;
+        for (; x + 16 <= width; x += 16)
+        {
+            __m128i b, g, r;
+            deinterleave16(src + 3 * x, b, g, r);
+
+            __m128i gray16[2];
+            for (int half = 0; half < 2; ++half)
+            {
+                const __m128i b16 = half ? _mm_unpackhi_epi8(b, zero) : _mm_unpacklo_epi8(b, zero);
+                const __m128i g16 = half ? _mm_unpackhi_epi8(g, zero) : _mm_unpacklo_epi8(g, zero);
+                const __m128i r16 = half ? _mm_unpackhi_epi8(r, zero) : _mm_unpacklo_epi8(r, zero);
+                const __m128i lo = _mm_srli_epi32(_mm_add_epi32(
+                    _mm_madd_epi16(_mm_unpacklo_epi16(b16, g16), blueGreen),
+                    _mm_madd_epi16(_mm_unpacklo_epi16(r16, round), redRound)), s_shift);
+                const __m128i hi = _mm_srli_epi32(_mm_add_epi32(
+                    _mm_madd_epi16(_mm_unpackhi_epi16(b16, g16), blueGreen),
+                    _mm_madd_epi16(_mm_unpackhi_epi16(r16, round), redRound)), s_shift);
+                gray16[half] = _mm_packs_epi32(lo, hi);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(gray16[0], gray16[1]));
+        }
+        for (; x < width; ++x)
+        {
+            dst[x] = toGray(src + 3 * x);
+        }
+    }
+#else
+    inline void convertRow(const std::uint8_t* src, std::uint8_t* dst, const int width)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            dst[x] = toGray(src + 3 * x);
+        }
+    }
+#endif
+}
+
+const char* grayscaleConversionKernel()
+{
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSSE3__) || defined(DRONE_SSSE3)
+    return "ssse3";
+#else
+    return "scalar";
+#endif
+}
+
+void convertToFlippedGrayscale(const std::span<const std::uint8_t> bgr, const int width, const int height, std::uint8_t* dst, const std::size_t dstStep)
+{
+    const std::size_t srcStep = static_cast<std::size_t>(width) * 3;
+    for (int y = 0; y < height; ++y)
+    {
+        convertRow(bgr.data() + (height - 1 - y) * srcStep, dst + y * dstStep, width);
+    }
+}
+
+void flipGrayscale(const std::span<const std::uint8_t> gray, const int width, const int height, std::uint8_t* dst, const std::size_t dstStep)
+{
+    for (int y = 0; y < height; ++y)
+    {
+        std::memcpy(dst + y * dstStep, gray.data() + static_cast<std::size_t>(height - 1 - y) * width, width);
+    }
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <utility>
+
+#include "LucasKanadeFlow.h"
+
+LucasKanadeFlow::LucasKanadeFlow(const int gridStep) :
+    m_gridStep{ gridStep }
+{
+}
+
+void LucasKanadeFlow::calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, const bool reusePrev)
+{
+    buildPyramids(prev, next, reusePrev);
+
+    // One point at the centre of every grid cell
+    const cv::Size gridSize((prev.cols + m_gridStep - 1) / m_gridStep, (prev.rows + m_gridStep - 1) / m_gridStep);
+    m_points.clear();
+    for (int y = 0; y < gridSize.height; ++y)
+    {
+        for (int x = 0; x < gridSize.width; ++x)
+        {
+            m_points.emplace_back(
+                std::min(x * m_gridStep + m_gridStep / 2, prev.cols - 1),
+                std::min(y * m_gridStep + m_gridStep / 2, prev.rows - 1));
+        }
+    }
+
+    track();
+
+    // Points that were lost take the mean of the tracked ones
+    const cv::Point2f mean = meanTracked();
+
+    m_gridFlow.create(gridSize, CV_32FC2);
+    for (int y = 0; y < gridSize.height; ++y)
+    {
+        cv::Point2f* row = m_gridFlow.ptr<cv::Point2f>(y);
+        for (int x = 0; x < gridSize.width; ++x)
+        {
+            const std::size_t i = static_cast<std::size_t>(y) * gridSize.width + x;
+            row[x] = m_status[i] ? m_tracked[i] - m_points[i] : mean;
+        }
+    }
+
+    cv::resize(m_gridFlow, flow, prev.size(), 0, 0, cv::INTER_LINEAR);
+}
+
+void LucasKanadeFlow::reset()
+{
+    m_nextPyramid.clear();
+    m_cachedSize = cv::Size();
+}
+
+[[nodiscard]] cv::Point2f LucasKanadeFlow::calcDiscMean(const cv::Mat& prev, const cv::Mat& next, const cv::Point2f centre, const int radius, const bool reusePrev)
+{
+    buildPyramids(prev, next, reusePrev);
+
+    m_points.clear();
+    for (int dy = -radius; dy <= radius; dy += s_discStep)
+    {
+        for (int dx = -radius; dx <= radius; dx += s_discStep)
+        {
+            if (dx * dx + dy * dy <= radius * radius)
+            {
+                m_points.emplace_back(centre.x + dx, centre.y + dy);
+            }
+        }
+    }
+
+    track();
+    return meanTracked();
+}
+
+void LucasKanadeFlow::buildPyramids(const cv::Mat& prev, const cv::Mat& next, const bool reusePrev)
+{
+    const cv::Size winSize(s_winSize, s_winSize);
+
+    // Like FarnebackFlow, the pyramid of the last next image serves as this prev
+    if (reusePrev && m_cachedSize == prev.size() && !m_nextPyramid.empty())
+    {
+        std::swap(m_prevPyramid, m_nextPyramid);
+    }
+    else
+    {
+        cv::buildOpticalFlowPyramid(prev, m_prevPyramid, winSize, s_maxLevel);
+    }
+    cv::buildOpticalFlowPyramid(next, m_nextPyramid, winSize, s_maxLevel);
+    m_cachedSize = next.size();
+}
+
+void LucasKanadeFlow::track()
+{
+    // A prediction moves every point's starting guess, and fewer levels then reach the rest
+    int maxLevel = s_maxLevel;
+    int flags = 0;
+    if (const std::optional<Prediction>& prediction = getPrediction())
+    {
+        maxLevel = levelsFor(prediction->error, 0.5, s_maxLevel);
+        flags = cv::OPTFLOW_USE_INITIAL_FLOW;
+        m_tracked.resize(m_points.size());
+        for (std::size_t i = 0; i < m_points.size(); ++i)
+        {
+            m_tracked[i] = m_points[i] + prediction->flow;
+        }
+    }
+
+    cv::calcOpticalFlowPyrLK(m_prevPyramid, m_nextPyramid, m_points, m_tracked, m_status, m_errors, cv::Size(s_winSize, s_winSize), maxLevel,
+        cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, 0.01), flags);
+}
+
+[[nodiscard]] cv::Point2f LucasKanadeFlow::meanTracked() const
+{
+    cv::Point2f mean{ 0.0f, 0.0f };
+    int tracked = 0;
+    for (std::size_t i = 0; i < m_points.size(); ++i)
+    {
+        if (m_status[i])
+        {
+            mean += m_tracked[i] - m_points[i];
+            ++tracked;
+        }
+    }
+    if (tracked > 0)
+    {
+        mean /= tracked;
+    }
+    return mean;
+}
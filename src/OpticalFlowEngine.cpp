@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "OpticalFlowEngine.h"
+#include "FarnebackFlow.h"
+#include "DISFlow.h"
+#include "LucasKanadeFlow.h"
+#include "PatchFlow.h"
+#include "BlockMatchFlow.h"
+#include "PhaseCorrelationFlow.h"
+
+[[nodiscard]] cv::Point2f OpticalFlowEngine::calcDiscMean(const cv::Mat& prev, const cv::Mat& next, const cv::Point2f centre, const int radius, const bool reusePrev)
+{
+    calc(prev, next, m_discFlow, reusePrev);
+
+    cv::Point2f mean{ 0.0f, 0.0f };
+
+    const int xMin = std::max(static_cast<int>(centre.x) - radius, 0);
+    const int xMax = std::min(static_cast<int>(centre.x) + radius, m_discFlow.cols - 1);
+    const int yMin = std::max(static_cast<int>(centre.y) - radius, 0);
+    const int yMax = std::min(static_cast<int>(centre.y) + radius, m_discFlow.rows - 1);
+
+    int counter = 0;
+    for (int x = xMin; x <= xMax; ++x)
+    {
+        for (int y = yMin; y <= yMax; ++y)
+        {
+            if (static_cast<long long>(centre.x - x) * (centre.x - x)
+                + static_cast<long long>(centre.y - y) * (centre.y - y)
+                <= static_cast<long long>(radius) * radius)
+            {
+                mean += m_discFlow.at<cv::Point2f>(y, x);
+                ++counter;
+            }
+        }
+    }
+
+    mean /= counter;
+    return mean;
+}
+
+[[nodiscard]] double OpticalFlowEngine::confidence() const
+{
+    return 1.0;
+}
+
+void OpticalFlowEngine::setPrediction(const std::optional<Prediction>& prediction)
+{
+    m_prediction = prediction;
+}
+
+[[nodiscard]] const std::optional<OpticalFlowEngine::Prediction>& OpticalFlowEngine::getPrediction() const
+{
+    return m_prediction;
+}
+
+[[nodiscard]] int OpticalFlowEngine::levelsFor(const float error, const double scale, const int maxLevels)
+{
+    int levels = 0;
+    for (double motion = error; levels < maxLevels && motion > s_levelReach; motion *= scale)
+    {
+        ++levels;
+    }
+    return levels;
+}
+
+[[nodiscard]] std::unique_ptr<OpticalFlowEngine> createOpticalFlowEngine(const std::string_view name)
+{
+    if (name == "farneback")
+    {
+        return std::make_unique<FarnebackFlow>();
+    }
+    if (name == "dis-ultrafast")
+    {
+        return std::make_unique<DISFlow>(DISFlow::Preset::UltraFast);
+    }
+    if (name == "dis-fast")
+    {
+        return std::make_unique<DISFlow>(DISFlow::Preset::Fast);
+    }
+    if (name == "dis-medium")
+    {
+        return std::make_unique<DISFlow>(DISFlow::Preset::Medium);
+    }
+    if (name == "lk")
+    {
+        return std::make_unique<LucasKanadeFlow>();
+    }
+    if (name == "patch")
+    {
+        return std::make_unique<PatchFlow>();
+    }
+    if (name == "block")
+    {
+        return std::make_unique<BlockMatchFlow>();
+    }
+    if (name == "phase")
+    {
+        return std::make_unique<PhaseCorrelationFlow>();
+    }
+    throw std::runtime_error("createOpticalFlowEngine: unknown optical flow engine " + std::string(name));
+}
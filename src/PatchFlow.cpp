@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cmath>
+
+#include "PatchFlow.h"
+
+namespace
+{
+    // Half-size average of src (CV_32FC1) into dst
+    void halve(const cv::Mat& src, cv::Mat& dst)
+    {
+        dst.create(src.rows / 2, src.cols / 2, CV_32F);
+        for (int y = 0; y < dst.rows; ++y)
+        {
+            const float* row0 = src.ptr<float>(2 * y);
+            const float* row1 = src.ptr<float>(2 * y + 1);
+            float* out = dst.ptr<float>(y);
+            for (int x = 0; x < dst.cols; ++x)
+            {
+                out[x] = 0.25f * (row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1]);
+            }
+        }
+    }
+
+    // Bilinear sample; false outside the image
+    bool sample(const cv::Mat& image, const float x, const float y, float& value)
+    {
+        const int x0 = static_cast<int>(std::floor(x));
+        const int y0 = static_cast<int>(std::floor(y));
+        if (x0 < 0 || y0 < 0 || x0 >= image.cols - 1 || y0 >= image.rows - 1)
+        {
+            return false;
+        }
+
+        const float ax = x - x0;
+        const float ay = y - y0;
+        const float* row0 = image.ptr<float>(y0);
+        const float* row1 = image.ptr<float>(y0 + 1);
+        value = (1.0f - ay) * ((1.0f - ax) * row0[x0] + ax * row0[x0 + 1]) + ay * ((1.0f - ax) * row1[x0] + ax * row1[x0 + 1]);
+        return true;
+    }
+}
+
+void PatchFlow::calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, bool)
+{
+    const cv::Point2f centre((prev.cols - 1) * 0.5f, (prev.rows - 1) * 0.5f);
+    const float radius = std::max(std::min(prev.cols, prev.rows) * 0.5f - s_searchMargin, 2.0f);
+    const cv::Point2f translation = estimate(prev, next, centre, radius);
+
+    flow.create(prev.size(), CV_32FC2);
+    flow = cv::Scalar(translation.x, translation.y);
+}
+
+void PatchFlow::reset()
+{
+}
+
+[[nodiscard]] cv::Point2f PatchFlow::calcDiscMean(const cv::Mat& prev, const cv::Mat& next, const cv::Point2f centre, const int radius, bool)
+{
+    return estimate(prev, next, centre, static_cast<float>(radius));
+}
+
+[[nodiscard]] cv::Point2f PatchFlow::estimate(const cv::Mat& prev, const cv::Mat& next, const cv::Point2f centre, const float radius)
+{
+    // Only the disc and the margin it can move within are read. A prediction moves the disc by up to its
+    // own length, and its error tells how many levels still have to search
+    const std::optional<Prediction>& prediction = getPrediction();
+    const int maxLevels = prediction ? levelsFor(prediction->error, 0.5, s_levels - 1) + 1 : s_levels;
+    const float predictedLength = prediction ? std::max(std::abs(prediction->flow.x), std::abs(prediction->flow.y)) : 0.0f;
+    const int reach = static_cast<int>(std::ceil(radius + predictedLength)) + s_searchMargin;
+    const cv::Rect crop = cv::Rect(
+        cv::Point(static_cast<int>(centre.x) - reach, static_cast<int>(centre.y) - reach),
+        cv::Point(static_cast<int>(centre.x) + reach + 2, static_cast<int>(centre.y) + reach + 2))
+        & cv::Rect(0, 0, prev.cols, prev.rows);
+
+    prev(crop).convertTo(m_prevLevels[0], CV_32F);
+    next(crop).convertTo(m_nextLevels[0], CV_32F);
+    int levels = 1;
+    for (; levels < maxLevels && std::min(m_prevLevels[levels - 1].cols, m_prevLevels[levels - 1].rows) >= 16; ++levels)
+    {
+        halve(m_prevLevels[levels - 1], m_prevLevels[levels]);
+        halve(m_nextLevels[levels - 1], m_nextLevels[levels]);
+    }
+
+    cv::Point2f d = prediction ? prediction->flow / static_cast<float>(1 << (levels - 1)) : cv::Point2f(0.0f, 0.0f);
+    for (int level = levels - 1; level >= 0; --level)
+    {
+        const cv::Mat& I0 = m_prevLevels[level];
+        const cv::Mat& I1 = m_nextLevels[level];
+        const float scale = 1.0f / static_cast<float>(1 << level);
+        // Pixel centres of a halved level sit between those of the level below
+        const float cx = (centre.x - crop.x + 0.5f) * scale - 0.5f;
+        const float cy = (centre.y - crop.y + 0.5f) * scale - 0.5f;
+        const float r = std::max(radius * scale, 2.0f);
+
+        const int x0 = std::max(static_cast<int>(std::ceil(cx - r)), 1);
+        const int x1 = std::min(static_cast<int>(std::floor(cx + r)), I0.cols - 2);
+        const int y0 = std::max(static_cast<int>(std::ceil(cy - r)), 1);
+        const int y1 = std::min(static_cast<int>(std::floor(cy + r)), I0.rows - 2);
+
+        // Inverse compositional: the gradients and Hessian are of prev and stay fixed while d is refined
+        double h11 = 0.0;
+        double h12 = 0.0;
+        double h22 = 0.0;
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                if ((x - cx) * (x - cx) + (y - cy) * (y - cy) > r * r)
+                {
+                    continue;
+                }
+                const float gx = 0.5f * (I0.ptr<float>(y)[x + 1] - I0.ptr<float>(y)[x - 1]);
+                const float gy = 0.5f * (I0.ptr<float>(y + 1)[x] - I0.ptr<float>(y - 1)[x]);
+                h11 += gx * gx;
+                h12 += gx * gy;
+                h22 += gy * gy;
+            }
+        }
+
+        // Without texture on this level, d is left as the coarser level found it
+        const double det = h11 * h22 - h12 * h12;
+        for (int i = 0; det > 1e-6 && i < s_iterations; ++i)
+        {
+            double b1 = 0.0;
+            double b2 = 0.0;
+            for (int y = y0; y <= y1; ++y)
+            {
+                for (int x = x0; x <= x1; ++x)
+                {
+                    float moved;
+                    if ((x - cx) * (x - cx) + (y - cy) * (y - cy) > r * r || !sample(I1, x + d.x, y + d.y, moved))
+                    {
+                        continue;
+                    }
+                    const float gx = 0.5f * (I0.ptr<float>(y)[x + 1] - I0.ptr<float>(y)[x - 1]);
+                    const float gy = 0.5f * (I0.ptr<float>(y + 1)[x] - I0.ptr<float>(y - 1)[x]);
+                    const float error = moved - I0.ptr<float>(y)[x];
+                    b1 += gx * error;
+                    b2 += gy * error;
+                }
+            }
+
+            const cv::Point2f update(
+                static_cast<float>((h22 * b1 - h12 * b2) / det),
+                static_cast<float>((h11 * b2 - h12 * b1) / det));
+            d -= update;
+            if (std::abs(update.x) < s_minUpdate && std::abs(update.y) < s_minUpdate)
+            {
+                break;
+            }
+        }
+
+        if (level > 0)
+        {
+            d *= 2.0f;
+        }
+    }
+
+    return d;
+}
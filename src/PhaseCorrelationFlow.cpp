@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "PhaseCorrelationFlow.h"
+
+namespace
+{
+    // The correlation is periodic, so neighbours of a border peak wrap around
+    float correlationAt(const cv::Mat& correlation, const int x, const int y)
+    {
+        return correlation.at<float>((y + correlation.rows) % correlation.rows, (x + correlation.cols) % correlation.cols);
+    }
+
+    // Offset of the true peak from the sampled one, from the larger neighbour's share of the pair
+    // (Foroosh et al.: a shifted peak is a sinc, sampled at d and 1 - d)
+    float subPixelOffset(const float before, const float peak, const float after)
+    {
+        if (after >= before)
+        {
+            return after > 0.0f ? after / (after + peak) : 0.0f;
+        }
+        return before > 0.0f ? -before / (before + peak) : 0.0f;
+    }
+}
+
+void PhaseCorrelationFlow::calc(const cv::Mat& prev, const cv::Mat& next, cv::Mat& flow, const bool reusePrev)
+{
+    const cv::Point2f shift = estimate(prev, next, reusePrev);
+
+    flow.create(prev.size(), CV_32FC2);
+    flow = cv::Scalar(shift.x, shift.y);
+}
+
+void PhaseCorrelationFlow::reset()
+{
+    m_hasNextSpectrum = false;
+}
+
+[[nodiscard]] cv::Point2f PhaseCorrelationFlow::calcDiscMean(const cv::Mat& prev, const cv::Mat& next, cv::Point2f, int, const bool reusePrev)
+{
+    // The disc moves with the whole window; only its shift is measured
+    return estimate(prev, next, reusePrev);
+}
+
+[[nodiscard]] double PhaseCorrelationFlow::confidence() const
+{
+    return m_confidence;
+}
+
+[[nodiscard]] cv::Point2f PhaseCorrelationFlow::estimate(const cv::Mat& prev, const cv::Mat& next, const bool reusePrev)
+{
+    // The window and transform sizes only change with the image size
+    if (prev.size() != m_size)
+    {
+        m_size = prev.size();
+        m_dftSize = cv::Size(cv::getOptimalDFTSize(m_size.width), cv::getOptimalDFTSize(m_size.height));
+        cv::createHanningWindow(m_window, m_size, CV_32F);
+        m_padded = cv::Mat::zeros(m_dftSize, CV_32F);
+        m_hasNextSpectrum = false;
+    }
+
+    if (reusePrev && m_hasNextSpectrum)
+    {
+        std::swap(m_prevSpectrum, m_nextSpectrum);
+    }
+    else
+    {
+        transform(prev, m_prevSpectrum);
+    }
+    transform(next, m_nextSpectrum);
+    m_hasNextSpectrum = true;
+
+    // next = prev shifted by d makes next * conj(prev) a pure phase ramp, whose inverse peaks at d
+    cv::mulSpectrums(m_nextSpectrum, m_prevSpectrum, m_crossPower, 0, true);
+    for (int y = 0; y < m_crossPower.rows; ++y)
+    {
+        cv::Point2f* row = m_crossPower.ptr<cv::Point2f>(y);
+        for (int x = 0; x < m_crossPower.cols; ++x)
+        {
+            const float magnitude = std::sqrt(row[x].x * row[x].x + row[x].y * row[x].y);
+            row[x] *= magnitude > FLT_EPSILON ? 1.0f / magnitude : 0.0f;
+        }
+    }
+    cv::dft(m_crossPower, m_correlation, cv::DFT_INVERSE | cv::DFT_REAL_OUTPUT | cv::DFT_SCALE);
+
+    const int width = m_correlation.cols;
+    const int height = m_correlation.rows;
+    cv::Point peak(0, 0);
+    float peakValue = m_correlation.at<float>(0, 0);
+    for (int y = 0; y < height; ++y)
+    {
+        const float* row = m_correlation.ptr<float>(y);
+        for (int x = 0; x < width; ++x)
+        {
+            if (row[x] > peakValue)
+            {
+                peakValue = row[x];
+                peak = cv::Point(x, y);
+            }
+        }
+    }
+
+    // A perfect shift concentrates all of the unit energy in the peak; what spreads past its 3x3
+    // neighbourhood is mismatch between the frames
+    double energy = 0.0;
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            energy += correlationAt(m_correlation, peak.x + dx, peak.y + dy);
+        }
+    }
+    m_confidence = std::clamp(energy, 0.0, 1.0);
+
+    const cv::Point2f shift(
+        peak.x + subPixelOffset(correlationAt(m_correlation, peak.x - 1, peak.y), peakValue, correlationAt(m_correlation, peak.x + 1, peak.y)),
+        peak.y + subPixelOffset(correlationAt(m_correlation, peak.x, peak.y - 1), peakValue, correlationAt(m_correlation, peak.x, peak.y + 1)));
+
+    // Peaks past half the size are negative shifts
+    return { shift.x > width / 2 ? shift.x - width : shift.x, shift.y > height / 2 ? shift.y - height : shift.y };
+}
+
+void PhaseCorrelationFlow::transform(const cv::Mat& image, cv::Mat& spectrum)
+{
+    // Without its mean, the window's own spectrum does not pull the peak towards zero shift
+    std::uint64_t total = 0;
+    for (int y = 0; y < m_size.height; ++y)
+    {
+        const std::uint8_t* source = image.ptr<std::uint8_t>(y);
+        for (int x = 0; x < m_size.width; ++x)
+        {
+            total += source[x];
+        }
+    }
+    const float mean = static_cast<float>(total) / m_size.area();
+
+    // The padding stays zero; only the image area is rewritten
+    for (int y = 0; y < m_size.height; ++y)
+    {
+        const std::uint8_t* source = image.ptr<std::uint8_t>(y);
+        const float* window = m_window.ptr<float>(y);
+        float* padded = m_padded.ptr<float>(y);
+        for (int x = 0; x < m_size.width; ++x)
+        {
+            padded[x] = (source[x] - mean) * window[x];
+        }
+    }
+    cv::dft(m_padded, spectrum, cv::DFT_COMPLEX_OUTPUT);
+}
@@ -6,14 +6,19 @@ VecDown::VecDown(const Drone& drone) :
 }
 
 void VecDown::calc()
+{
+    calc(m_drone->getGyroData());
+}
+
+void VecDown::calc(const std::array<double, 3>& gyroData)
 {
     if (!m_hasPrev)
     {
-        m_vecDown = calcVecDownProjection();
+        m_vecDown = calcVecDownProjection(gyroData);
         m_hasPrev = true;
     }
 
-    const cv::Point2f vecDown = calcVecDownProjection();
+    const cv::Point2f vecDown = calcVecDownProjection(gyroData);
     m_vecDownDisplacement = vecDown - m_vecDown;
     m_vecDown = vecDown;
 }
@@ -38,10 +43,8 @@ cv::Point2f VecDown::getVecDownDisplacement() const
 
 [[nodiscard]] cv::Point2f getVecDownDisplacement();
 
-cv::Vec3d VecDown::calcVecDown3d() const
+cv::Vec3d VecDown::calcVecDown3d(const std::array<double, 3>& gyroData)
 {
-    std::vector<double> gyroData = m_drone->getGyroData();
-
     const cv::Vec3f vecDown{ 0.0f, 0.0f, -1.0f };
 
     const cv::Matx33d Rx(1, 0, 0,
@@ -61,9 +64,9 @@ cv::Vec3d VecDown::calcVecDown3d() const
     return R * vecDown;
 }
 
-cv::Point2f VecDown::calcVecDownProjection() const
+cv::Point2f VecDown::calcVecDownProjection(const std::array<double, 3>& gyroData) const
 {
-    cv::Vec3d v = calcVecDown3d();
+    cv::Vec3d v = calcVecDown3d(gyroData);
 
     double depth = -v[2];
 
@@ -1,49 +1,210 @@
 #include "VecMove.h"
 
-VecMove::VecMove(const Drone& drone) :
+VecMove::VecMove(const Drone& drone, std::unique_ptr<OpticalFlowEngine> flowEngine) :
     m_drone{ &drone },
+    m_framePool(drone.getFullFrame().size(), CV_8UC1, s_poolFrames),
     m_vecDown(drone),
-    m_cameraOpticalFlow(drone)
+    m_cameraOpticalFlow(drone, std::move(flowEngine))
 {
 }
 
 void VecMove::calc()
 {
-    m_vecDown.calc();
+    // Queue all reads of this step at once; the altitude is still on the wire while the optical flow is computed
+    const RemoteAPIFuture gyroRequest = m_drone->requestGyroData();
+    Drone::FrameRequest frameRequest = m_drone->requestGrayscaleImage(m_frameWindow);
+    const RemoteAPIFuture altitudeRequest = m_drone->requestAltitude();
 
-    const cv::Point2f p = m_vecDown.getVecDown();
+    const std::array<double, 3> gyroData = Drone::getGyroData(gyroRequest);
+    if (!coversFlowWindow(frameRequest.window, gyroData))
+    {
+        frameRequest = m_drone->requestGrayscaleImage(m_drone->getFullFrame());
+    }
 
-    m_cameraOpticalFlow.calc(static_cast<int>(p.x), static_cast<int>(p.y), s_calcFlowPixels);
+    FramePool::Frame frame = m_framePool.acquire();
+    m_drone->getGrayscaleImage(frameRequest, *frame);
+    storeFrame(std::move(frame), frameRequest.window, gyroData);
+    calc(gyroData, altitudeRequest);
+}
 
-    cv::Point2f meanOpticalFlow{ 0.0f, 0.0f };
+RemoteAPITask VecMove::calcAsync(const RemoteAPIClock::time_point deadline)
+{
+    const RemoteAPIFuture gyroRequest = m_drone->requestGyroData();
+    Drone::FrameRequest frameRequest = m_drone->requestGrayscaleImage(m_frameWindow);
+    const RemoteAPIFuture altitudeRequest = m_drone->requestAltitude();
 
-    const int xMin = std::max(static_cast<int>(p.x) - s_accountFlowPixels, 0);
-    const int xMax = std::min(static_cast<int>(p.x) + s_accountFlowPixels, m_drone->cameraInfo.resolutionX - 1);
-    const int yMin = std::max(static_cast<int>(p.y) - s_accountFlowPixels, 0);
-    const int yMax = std::min(static_cast<int>(p.y) + s_accountFlowPixels, m_drone->cameraInfo.resolutionY - 1);
+    // A late reply is dropped when it arrives; the control loop goes on with the previous vector
+    m_isStale = !co_await gyroRequest.until(deadline) || !co_await frameRequest.reply.until(deadline);
+    if (m_isStale)
+    {
+        co_return;
+    }
 
-    int counter = 0;
-    for (int x = xMin; x <= xMax; ++x)
+    const std::array<double, 3> gyroData = Drone::getGyroData(gyroRequest);
+    if (!coversFlowWindow(frameRequest.window, gyroData))
     {
-        for (int y = yMin; y <= yMax; ++y)
+        // The down vector left the window: this step needs the whole frame
+        frameRequest = m_drone->requestGrayscaleImage(m_drone->getFullFrame());
+        m_isStale = !co_await frameRequest.reply.until(deadline);
+        if (m_isStale)
         {
-            if (static_cast<long long>(p.x - x) * (p.x - x)
-                + static_cast<long long>(p.y - y) * (p.y - y)
-                <= static_cast<long long>(s_accountFlowPixels) * s_accountFlowPixels)
-            {
-                meanOpticalFlow += m_cameraOpticalFlow.getOpticalFlowAt(x, y);
-                ++counter;
-            }
+            co_return;
         }
     }
 
-    meanOpticalFlow /= counter;
+    FramePool::Frame frame = m_framePool.acquire();
+    m_drone->getGrayscaleImage(frameRequest, *frame);
+    storeFrame(std::move(frame), frameRequest.window, gyroData);
+    calc(gyroData, altitudeRequest);
+}
 
-    m_vecMove = (m_drone->getAltitude() / m_drone->cameraInfo.focalLength) * (m_vecDown.getVecDownDisplacement() - meanOpticalFlow);
+RemoteAPITask VecMove::calcAsync(Drone::SensorSnapshot snapshot, const RemoteAPIClock::time_point deadline)
+{
+    m_isStale = false;
+    if (!coversFlowWindow(snapshot.window, snapshot.gyroData))
+    {
+        // The down vector left the window: this step needs the whole frame
+        const Drone::FrameRequest frameRequest = m_drone->requestGrayscaleImage(m_drone->getFullFrame());
+        m_isStale = !co_await frameRequest.reply.until(deadline);
+        if (m_isStale)
+        {
+            co_return;
+        }
+        FramePool::Frame frame = m_framePool.acquire();
+        m_drone->getGrayscaleImage(frameRequest, *frame);
+        storeFrame(std::move(frame), frameRequest.window, snapshot.gyroData);
+    }
+    else
+    {
+        storeFrame(std::move(snapshot.frame), snapshot.window, snapshot.gyroData);
+    }
 
+    const std::optional<cv::Point2f> meanOpticalFlow = calcMeanOpticalFlow(snapshot.gyroData);
+    m_isStale = !meanOpticalFlow;
+    if (m_isStale)
+    {
+        co_return;
+    }
+    m_vecMove = (snapshot.position[2] / m_drone->cameraInfo.focalLength) * (m_vecDown.getVecDownDisplacement() - *meanOpticalFlow);
     m_hasPrev = true;
 }
 
+cv::Rect VecMove::getFrameWindow() const
+{
+    return m_frameWindow;
+}
+
+FramePool::Frame VecMove::acquireFrame()
+{
+    return m_framePool.acquire();
+}
+
+FramePool::Frame VecMove::getFrame() const
+{
+    return m_frame;
+}
+
+cv::Rect VecMove::getFrameReadWindow() const
+{
+    return m_frameReadWindow;
+}
+
+cv::Rect VecMove::calcFlowWindow(const std::array<double, 3>& gyroData, const int margin) const
+{
+    const cv::Point2f p = m_vecDown.calcVecDownProjection(gyroData);
+    const int len = s_calcFlowPixels + margin;
+    const cv::Rect window(
+        cv::Point(static_cast<int>(p.x) - len, static_cast<int>(p.y) - len),
+        cv::Point(static_cast<int>(p.x) + len + 1, static_cast<int>(p.y) + len + 1));
+    return window & m_drone->getFullFrame();
+}
+
+bool VecMove::coversFlowWindow(const cv::Rect& window, const std::array<double, 3>& gyroData) const
+{
+    const cv::Rect flowWindow = calcFlowWindow(gyroData, 0);
+    return (flowWindow & window) == flowWindow;
+}
+
+void VecMove::storeFrame(FramePool::Frame frame, const cv::Rect& window, const std::array<double, 3>& gyroData)
+{
+    // Pixels outside the window are left from whatever the pool frame held before; the optical flow never reads them
+    m_prevFrameReadWindow = m_frameReadWindow;
+    m_frame = std::move(frame);
+    m_frameReadWindow = window;
+
+    // The window only follows the down vector after a full frame, so the previous frame always covers it
+    if (window == m_drone->getFullFrame())
+    {
+        m_frameWindow = calcFlowWindow(gyroData, s_frameWindowMargin);
+    }
+}
+
+void VecMove::calc(const std::array<double, 3>& gyroData, const RemoteAPIFuture& altitudeRequest)
+{
+    const double altitude = Drone::getAltitude(altitudeRequest);
+    const std::optional<cv::Point2f> meanOpticalFlow = calcMeanOpticalFlow(gyroData);
+    m_isStale = !meanOpticalFlow;
+    if (m_isStale)
+    {
+        return;
+    }
+
+    m_vecMove = (altitude / m_drone->cameraInfo.focalLength) * (m_vecDown.getVecDownDisplacement() - *meanOpticalFlow);
+
+    m_hasPrev = true;
+}
+
+std::optional<cv::Point2f> VecMove::calcMeanOpticalFlow(const std::array<double, 3>& gyroData)
+{
+    m_vecDown.calc(gyroData);
+
+    const cv::Point2f p = m_vecDown.getVecDown();
+
+    // Only pixels read into both this frame and the previous one are current in both. When the down vector
+    // moved out of the previous window, e.g. on the step that falls back to a full frame, the previous frame
+    // does not hold what the flow needs: the step is dropped and the flow starts over from this frame
+    const cv::Rect neededWindow = calcFlowWindow(gyroData, 0);
+    const cv::Rect validWindow = m_prevFrameReadWindow.empty() ? m_frameReadWindow : m_frameReadWindow & m_prevFrameReadWindow;
+    if (!m_prevFrameReadWindow.empty() && (neededWindow & validWindow) != neededWindow)
+    {
+        m_cameraOpticalFlow.restart(m_frame);
+        return std::nullopt;
+    }
+
+    // A window that stays put lets the optical flow reuse the previous frame's pyramid; it must hold the
+    // pixels around the down vector and only pixels that are current
+    if ((neededWindow & m_flowWindow) != neededWindow || (m_flowWindow & validWindow) != m_flowWindow)
+    {
+        m_flowWindow = calcFlowWindow(gyroData, s_flowWindowMargin) & validWindow;
+    }
+
+    // The rotation the gyro measured moves the image by the down vector's displacement; the translation
+    // changes little from one step to the next. Together they warm-start the engine
+    const cv::Point2f displacement = m_vecDown.getVecDownDisplacement();
+    const cv::Point2f predictedFlow = displacement + m_flowTranslation;
+
+    // Only the disc around the down vector is consumed; dense engines average their field over it,
+    // sparse ones estimate it directly
+    const cv::Point2f meanOpticalFlow = m_cameraOpticalFlow.calcDiscMean(m_frame, m_flowWindow, p, s_accountFlowPixels, predictedFlow);
+    m_flowTranslation = meanOpticalFlow - displacement;
+    return meanOpticalFlow;
+}
+
+bool VecMove::hasVecMove() const
+{
+    return m_hasPrev;
+}
+
+bool VecMove::isStale() const
+{
+    return m_isStale;
+}
+
+double VecMove::getFlowConfidence() const
+{
+    return m_cameraOpticalFlow.getConfidence();
+}
+
 cv::Point2f VecMove::getVecMove() const
 {
     if (!m_hasPrev)
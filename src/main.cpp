@@ -2,19 +2,27 @@
 #include <windows.h>
 
 #include "RemoteAPIClient.h"
+#include "RemoteAPIRecording.h"
+#include "RemoteAPIStandIn.h"
+#include "RemoteAPITask.h"
 
 #include "Drone.h"
+#include "DroneStandInBackend.h"
+#include "OpticalFlowEngine.h"
 #include "VecMove.h"
 
 void showOpticalFlow(const cv::Mat& grayFrame,
+                     const cv::Rect& readWindow,
                      const VecMove& vecMove,
                      const std::pair<int, int>& frameSize,
                      const int step,
                      const float resizeFactor,
                      const float dt)
 {
-    cv::Mat display;
-    cv::cvtColor(grayFrame, display, cv::COLOR_GRAY2BGR);
+    // Only the window read this step is current; the rest of the shared frame is left black
+    cv::Mat display = cv::Mat::zeros(grayFrame.size(), CV_8UC3);
+    cv::Mat displayWindow = display(readWindow);
+    cv::cvtColor(grayFrame(readWindow), displayWindow, cv::COLOR_GRAY2BGR);
     cv::resize(display, display, cv::Size(), resizeFactor, resizeFactor, cv::INTER_LINEAR);
 
     const cv::Point2f move = vecMove.getVecMove() / dt / 100;
@@ -69,37 +77,44 @@ void showOpticalFlow(const cv::Mat& grayFrame,
                     cv::Scalar(255, 0, 0), 2, cv::LINE_AA, 0, 0.3);
 
     cv::imshow("Bottom camera", display);
-    cv::waitKey(1);
 }
 
-int main(int argc, char* argv[])
+struct LoopState
+{
+    bool stop = false;
+    bool hasVecMove = false;
+    double dt = 0.0;
+    std::uint64_t steps = 0;
+    std::uint64_t staleSteps = 0;
+    RemoteAPIEvent stepped; // set by the control task after every step
+};
+
+// Sensor reads of a step that take longer are given up; forces are still applied with the previous vector
+constexpr std::chrono::milliseconds s_visionBudget{ 30 };
+
+RemoteAPITask controlTask(RemoteAPIObject::sim& sim, Drone& drone, VecMove& vecMove, LoopState& state)
 {
-    RemoteAPIClient client;
-    RemoteAPIObject::sim sim = client.getObject().sim();
-
-    Drone drone(sim);
-    sim.setStepping(true);
-    sim.startSimulation();
-
-    VecMove vecMove(drone);
-
     auto t1 = std::chrono::high_resolution_clock::now();
 
-    while (true)
+    while (!state.stop)
     {
-        auto imgData = drone.getGrayscaleImage();
-
-        double dt = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - t1).count() / 1e6;
-        t1 = std::chrono::high_resolution_clock::now();
-        if (!imgData.empty())
-        {;
-            vecMove.calc();
-            showOpticalFlow(imgData, vecMove, { drone.cameraInfo.resolutionX, drone.cameraInfo.resolutionY }, 16, 1.5, dt);
+        // All readings of the step in one round trip
+        const RemoteAPIClock::time_point deadline = RemoteAPIClock::now() + s_visionBudget;
+        const RemoteAPIFuture snapshotRequest = drone.requestSnapshot(vecMove.getFrameWindow());
+        const bool hasSnapshot = co_await snapshotRequest.until(deadline);
+        Drone::SensorSnapshot snapshot;
+        if (hasSnapshot)
+        {
+            snapshot = drone.getSnapshot(snapshotRequest, vecMove.acquireFrame());
+            co_await vecMove.calcAsync(snapshot, deadline);
         }
 
-        if (cv::waitKey(10) == 27)
+        state.dt = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - t1).count() / 1e6;
+        t1 = std::chrono::high_resolution_clock::now();
+        state.hasVecMove = vecMove.hasVecMove();
+        if (!hasSnapshot || vecMove.isStale())
         {
-            break;
+            ++state.staleSteps;
         }
 
         if (GetAsyncKeyState(VK_UP))
@@ -119,12 +134,99 @@ int main(int argc, char* argv[])
             drone.setAngularVelocities({ 0.0, 0.0, 0.0, 0.0 });
         }
 
-        drone.update();
+        if (hasSnapshot)
+        {
+            drone.update(snapshot);
+        }
+        else
+        {
+            drone.update();
+        }
 
-        sim.step();
+        co_await sim.stepAsync();
+        ++state.steps;
+        state.stepped.set();
     }
+}
+
+RemoteAPITask displayTask(const Drone& drone, const VecMove& vecMove, LoopState& state)
+{
+    // Parked until a step is done, so the scheduler can block on the socket meanwhile; it then draws
+    // while the control task waits for the next snapshot
+    while (!state.stop)
+    {
+        co_await state.stepped;
+
+        if (state.hasVecMove)
+        {
+            // The frame the optical flow used, not a second read; it stays out of the pool while held here
+            const FramePool::Frame frame = vecMove.getFrame();
+
+            if (frame)
+            {
+                showOpticalFlow(*frame, vecMove.getFrameReadWindow(), vecMove, { drone.cameraInfo.resolutionX, drone.cameraInfo.resolutionY }, 16, 1.5, state.dt);
+            }
+        }
+
+        if (cv::waitKey(1) == 27)
+        {
+            state.stop = true;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // e.g. "ipc:///tmp/coppeliasim" when the simulator's remote API server binds an ipc endpoint,
+    // "inproc://sim" to run against an in-process stand-in instead of CoppeliaSim, or
+    // "replay://session.log" to rerun a session recorded with REMOTEAPI_RECORD=session.log
+    const std::string endpoint = argc > 1 ? argv[1] : "localhost";
+    // Optical flow backend (see createOpticalFlowEngine), from most accurate to cheapest:
+    // "farneback", "dis-medium", "dis-fast", "dis-ultrafast", "lk", "patch", "block", "phase"
+    const std::string flowEngine = argc > 2 ? argv[2] : "farneback";
+    const bool replay = endpoint.starts_with("replay://");
+    DroneStandInBackend standInBackend;
+    std::unique_ptr<RemoteAPIStandIn> standIn; // outlive the client, which ends its session when destroyed
+    std::unique_ptr<RemoteAPIReplay> replayServer;
+    RemoteAPIClient client(replay ? "inproc://replay" : endpoint);
+    if (replay)
+    {
+        replayServer = std::make_unique<RemoteAPIReplay>(endpoint.substr(9), client.context());
+        replayServer->bind(client.rpcEndpoint());
+        replayServer->start();
+    }
+    else if (client.transport() == "inproc")
+    {
+        standIn = std::make_unique<RemoteAPIStandIn>(standInBackend, client.context());
+        standIn->bind(client.rpcEndpoint());
+        standIn->start();
+    }
+    RemoteAPIObject::sim sim = client.getObject().sim();
+
+    // Sensor reads of a step are pipelined; sim.step is always sent alone (see RemoteAPIClient::setExclusive)
+    client.setMaxInFlight(4);
+
+    Drone drone(sim);
+    sim.setStepping(true);
+    sim.startSimulation();
+
+    VecMove vecMove(drone, createOpticalFlowEngine(flowEngine));
+
+    LoopState state;
+    RemoteAPIScheduler scheduler(client);
+    scheduler.spawn(controlTask(sim, drone, vecMove, state));
+    scheduler.spawn(displayTask(drone, vecMove, state));
+    scheduler.run();
 
     sim.stopSimulation();
 
+    const RemoteAPIClient::LatencyStats& latency = client.latencyStats();
+    std::cout << "Transport: " << client.transport()
+              << ", optical flow: " << flowEngine
+              << ", calls: " << latency.calls
+              << ", mean latency: " << latency.mean().count() / 1e3 << " us"
+              << ", max latency: " << latency.max.count() / 1e3 << " us"
+              << ", stale steps: " << state.staleSteps << " of " << state.steps << std::endl;
+
     return 0;
 }
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "BlockMatchFlow.h"
+
+// BlockMatchFlow::sad, in whichever SIMD kernel this build selected, against the scalar reference: every
+// block shape the search uses, unaligned rows and strides, and the all-255 worst case for the sums
+int main()
+{
+    constexpr std::size_t s_step = 131;
+    constexpr int s_rows = 40;
+
+    std::mt19937 random(23);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<std::uint8_t> a(s_step * s_rows + 64);
+    std::vector<std::uint8_t> b(s_step * s_rows + 64);
+
+    int failures = 0;
+    const auto check = [&](const std::size_t aOffset, const std::size_t bOffset, const int width, const int rows)
+    {
+        const unsigned expected = BlockMatchFlow::sadScalar(a.data() + aOffset, s_step, b.data() + bOffset, s_step, width, rows);
+        const unsigned actual = BlockMatchFlow::sad(a.data() + aOffset, s_step, b.data() + bOffset, s_step, width, rows);
+        if (actual != expected)
+        {
+            std::cerr << BlockMatchFlow::sadKernel() << " sad of " << width << "x" << rows << " at offsets "
+                      << aOffset << ", " << bOffset << ": " << actual << ", scalar: " << expected << std::endl;
+            ++failures;
+        }
+    };
+
+    for (int trial = 0; trial < 50; ++trial)
+    {
+        for (auto& v : a)
+        {
+            v = static_cast<std::uint8_t>(byte(random));
+        }
+        for (auto& v : b)
+        {
+            v = static_cast<std::uint8_t>(byte(random));
+        }
+        const std::size_t aOffset = static_cast<std::size_t>(trial % 17);
+        const std::size_t bOffset = static_cast<std::size_t>((trial * 7) % 23);
+        check(aOffset, bOffset, BlockMatchFlow::s_blockSize / 2, BlockMatchFlow::s_blockSize / 2);
+        check(aOffset, bOffset, BlockMatchFlow::s_blockSize, BlockMatchFlow::s_blockSize);
+    }
+
+    std::fill(a.begin(), a.end(), std::uint8_t{ 255 });
+    std::fill(b.begin(), b.end(), std::uint8_t{ 0 });
+    check(0, 0, BlockMatchFlow::s_blockSize, BlockMatchFlow::s_blockSize);
+    check(3, 5, BlockMatchFlow::s_blockSize / 2, BlockMatchFlow::s_blockSize / 2);
+
+    if (failures == 0)
+    {
+        std::cout << "The " << BlockMatchFlow::sadKernel() << " block SAD matches the scalar one" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <opencv2/opencv.hpp>
+
+#include "FarnebackFlow.h"
+#include "LucasKanadeFlow.h"
+#include "PatchFlow.h"
+#include "ShiftedTexture.h"
+
+// The engines that estimate a disc's mean flow directly (PatchFlow, LucasKanadeFlow) against the dense field
+// of FarnebackFlow averaged over the same disc, OpticalFlowEngine's default, on VecMove's window of a blurred
+// random texture moved by sub-pixel shifts of either sign
+namespace
+{
+    // Both sides are about 0.05 px off the true shift on this texture and differ from each other by up to
+    // 0.02 px; a shortcut that reads the wrong pixels or drops the sub-pixel part is off by far more
+    constexpr double s_maxDifference = 0.05;
+}
+
+int main()
+{
+    const ShiftedTexture texture(2.0);
+    const cv::Mat prev = texture.frame({ 0.0f, 0.0f });
+    const cv::Point2f centre(prev.cols * 0.5f, prev.rows * 0.5f);
+    const int radius = VecMove::getFlowDiscRadius();
+
+    FarnebackFlow farneback;
+    PatchFlow patch;
+    LucasKanadeFlow lucasKanade;
+    OpticalFlowEngine* const engines[] = { &patch, &lucasKanade };
+    const char* const names[] = { "patch", "lk" };
+
+    int failures = 0;
+    for (const cv::Point2f shift : { cv::Point2f(0.4f, -0.3f), cv::Point2f(1.3f, -0.7f), cv::Point2f(-2.6f, 1.4f), cv::Point2f(-3.2f, -2.1f) })
+    {
+        const cv::Mat next = texture.frame(shift);
+        farneback.reset();
+        const cv::Point2f expected = farneback.OpticalFlowEngine::calcDiscMean(prev, next, centre, radius, false);
+        for (std::size_t i = 0; i < std::size(engines); ++i)
+        {
+            engines[i]->reset();
+            const cv::Point2f mean = engines[i]->calcDiscMean(prev, next, centre, radius, false);
+            const double difference = std::hypot(mean.x - expected.x, mean.y - expected.y);
+            std::cout << "shift (" << shift.x << ", " << shift.y << "), " << names[i] << ": (" << mean.x << ", " << mean.y
+                      << "), dense farneback: (" << expected.x << ", " << expected.y << "), difference " << difference << " px" << std::endl;
+            if (difference > s_maxDifference)
+            {
+                ++failures;
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "FarnebackFlow.h"
+#include "ShiftedTexture.h"
+
+// FarnebackFlow against the cv::calcOpticalFlowFarneback it was ported from, with the same parameters, on
+// VecMove's window of a blurred random texture moved by sub-pixel shifts. The second pair reuses the first
+// pair's cached expansion, which must not change the result either
+namespace
+{
+    // Only float rounding may differ between the two
+    constexpr double s_maxMeanDifference = 1e-3;
+    constexpr double s_maxDifference = 1e-2;
+
+    bool matches(const char* name, const cv::Mat& flow, const cv::Mat& expected)
+    {
+        double sum = 0.0;
+        double largest = 0.0;
+        for (int y = 0; y < flow.rows; ++y)
+        {
+            for (int x = 0; x < flow.cols; ++x)
+            {
+                const cv::Point2f d = flow.at<cv::Point2f>(y, x) - expected.at<cv::Point2f>(y, x);
+                const double difference = std::hypot(d.x, d.y);
+                sum += difference;
+                largest = std::max(largest, difference);
+            }
+        }
+        const double mean = sum / flow.total();
+        std::cout << name << ": mean difference " << mean << " px, largest " << largest << " px" << std::endl;
+        return mean <= s_maxMeanDifference && largest <= s_maxDifference;
+    }
+}
+
+int main()
+{
+    const ShiftedTexture texture(2.0);
+    const cv::Mat frames[] = { texture.frame({ 0.0f, 0.0f }), texture.frame({ 1.3f, -0.7f }), texture.frame({ 2.6f, -1.4f }) };
+
+    const FarnebackFlow::Params params;
+    FarnebackFlow farneback(params);
+    bool passed = true;
+    for (int i = 0; i < 2; ++i)
+    {
+        cv::Mat flow;
+        farneback.calc(frames[i], frames[i + 1], flow, i > 0);
+
+        cv::Mat expected;
+        cv::calcOpticalFlowFarneback(frames[i], frames[i + 1], expected, params.pyrScale, params.levels, params.winSize,
+                                     params.iterations, params.polyN, params.polySigma, 0);
+        passed = matches(i > 0 ? "second pair, cached expansion" : "first pair", flow, expected) && passed;
+    }
+    return passed ? 0 : 1;
+}
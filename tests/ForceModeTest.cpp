@@ -0,0 +1,155 @@
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "RemoteAPIClient.h"
+#include "RemoteAPIStandIn.h"
+
+#include "Drone.h"
+#include "DroneStandInBackend.h"
+
+// Drone::update in both force modes, through the in-process stand-in: the body-frame path must apply
+// the same thrust and torque to every propeller as the per-propeller world-frame path, which reads each
+// propeller's own spin-turned orientation
+namespace
+{
+    struct AppliedForce
+    {
+        std::array<double, 3> force{};
+        std::array<double, 3> torque{};
+    };
+
+    using Rotation = std::array<std::array<double, 3>, 3>;
+
+    // Euler angles as Drone::rotateForce reads them: R = Rz(angles[2]) * Ry(angles[1]) * Rx(angles[0])
+    Rotation fromAngles(const std::array<double, 3>& angles)
+    {
+        const double cx = std::cos(angles[0]);
+        const double sx = std::sin(angles[0]);
+        const double cy = std::cos(angles[1]);
+        const double sy = std::sin(angles[1]);
+        const double cz = std::cos(angles[2]);
+        const double sz = std::sin(angles[2]);
+        return { { { cz * cy, cz * sy * sx - sz * cx, cz * sy * cx + sz * sx },
+                   { sz * cy, sz * sy * sx + cz * cx, sz * sy * cx - cz * sx },
+                   { -sy, cy * sx, cy * cx } } };
+    }
+
+    std::array<double, 3> toAngles(const Rotation& r)
+    {
+        return { std::atan2(r[2][1], r[2][2]), -std::asin(r[2][0]), std::atan2(r[1][0], r[0][0]) };
+    }
+
+    Rotation multiply(const Rotation& a, const Rotation& b)
+    {
+        Rotation r{};
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            for (std::size_t j = 0; j < 3; ++j)
+            {
+                for (std::size_t k = 0; k < 3; ++k)
+                {
+                    r[i][j] += a[i][k] * b[k][j];
+                }
+            }
+        }
+        return r;
+    }
+
+    // Tilted body, so that the rotation matters, with each propeller turned about the rotor axis by its own
+    // angle as it spins: body * Rz(phi). Records what is applied to each handle
+    class RecordingBackend : public DroneStandInBackend
+    {
+    public:
+        std::array<double, 3> orientation(const std::int64_t handle) override
+        {
+            const std::string& path = objectPath(handle);
+            for (std::size_t i = 0; i < s_spins.size(); ++i)
+            {
+                if (path == "/Quadcopter/propeller[" + std::to_string(i) + "]/respondable")
+                {
+                    return toAngles(multiply(fromAngles(s_bodyAngles), fromAngles({ 0.0, 0.0, s_spins[i] })));
+                }
+            }
+            return s_bodyAngles;
+        }
+
+        void addForceAndTorque(const std::int64_t handle, const std::array<double, 3>& force, const std::array<double, 3>& torque) override
+        {
+            m_applied[handle] = { force, torque };
+            DroneStandInBackend::addForceAndTorque(handle, force, torque);
+        }
+
+        std::map<std::int64_t, AppliedForce> m_applied;
+
+    private:
+        static constexpr std::array<double, 3> s_bodyAngles = { 0.12, -0.21, 0.35 };
+        static constexpr std::array<double, 4> s_spins = { 0.4, 1.9, -2.7, 3.0 };
+    };
+
+    std::map<std::int64_t, AppliedForce> applyForces(Drone& drone, RecordingBackend& backend, const Drone::ForceMode mode)
+    {
+        // The stand-in answers every call before the client returns, so the recorded values are complete here
+        backend.m_applied.clear();
+        drone.setForceMode(mode);
+        drone.update();
+        return backend.m_applied;
+    }
+}
+
+int main()
+{
+    const double tolerance = 1e-12;
+
+    RecordingBackend backend;
+    std::unique_ptr<RemoteAPIStandIn> standIn; // outlive the client, which ends its session when destroyed
+    RemoteAPIClient client("inproc://force-mode-test");
+    standIn = std::make_unique<RemoteAPIStandIn>(backend, client.context());
+    standIn->bind(client.rpcEndpoint());
+    standIn->start();
+    RemoteAPIObject::sim sim = client.getObject().sim();
+
+    Drone drone(sim);
+    drone.setAngularVelocities({ 400.0, 430.0, 415.0, 445.0 });
+
+    const std::map<std::int64_t, AppliedForce> world = applyForces(drone, backend, Drone::ForceMode::PerPropeller);
+    const std::map<std::int64_t, AppliedForce> body = applyForces(drone, backend, Drone::ForceMode::Body);
+
+    int failures = 0;
+    if (world.size() != Drone::s_propellersCount || body.size() != Drone::s_propellersCount)
+    {
+        std::cerr << "expected forces on " << Drone::s_propellersCount << " propellers, got "
+                  << world.size() << " (per propeller) and " << body.size() << " (body)" << std::endl;
+        return 1;
+    }
+    for (const auto& [handle, expected] : world)
+    {
+        const auto it = body.find(handle);
+        if (it == body.end())
+        {
+            std::cerr << "body mode applied no force to handle " << handle << std::endl;
+            ++failures;
+            continue;
+        }
+        for (std::size_t k = 0; k < 3; ++k)
+        {
+            if (std::abs(it->second.force[k] - expected.force[k]) > tolerance
+                || std::abs(it->second.torque[k] - expected.torque[k]) > tolerance)
+            {
+                std::cerr << "handle " << handle << ", axis " << k
+                          << ": force " << it->second.force[k] << " vs " << expected.force[k]
+                          << ", torque " << it->second.torque[k] << " vs " << expected.torque[k] << std::endl;
+                ++failures;
+            }
+        }
+    }
+
+    if (failures == 0)
+    {
+        std::cout << "Body and per-propeller force modes apply the same forces" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
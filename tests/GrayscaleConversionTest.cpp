@@ -0,0 +1,48 @@
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <opencv2/opencv.hpp>
+
+#include "GrayscaleConversion.h"
+
+// convertToFlippedGrayscale, in whichever row kernel this build selected, and flipGrayscale against the
+// cv::cvtColor and cv::flip they replace: identical values for widths that are and are not a multiple of the
+// kernels' vector width, so the scalar tails are covered, and for a destination with padded rows
+int main()
+{
+    int failures = 0;
+    for (const int width : { 1, 7, 15, 16, 31, 32, 33, 63, 64, 65, 127, 640 })
+    {
+        const int height = 9;
+        cv::Mat bgr(height, width, CV_8UC3);
+        cv::randu(bgr, cv::Scalar::all(0), cv::Scalar::all(256));
+        cv::Mat expected;
+        cv::cvtColor(bgr, expected, cv::COLOR_BGR2GRAY);
+        cv::flip(expected, expected, 0);
+
+        // Rows of the destination a few bytes longer than the image
+        cv::Mat padded(height, width + 5, CV_8UC1, cv::Scalar::all(0));
+        cv::Mat gray = padded(cv::Rect(0, 0, width, height));
+        convertToFlippedGrayscale(std::span<const std::uint8_t>(bgr.data, bgr.total() * bgr.elemSize()), width, height, gray.data, gray.step);
+        const int converted = cv::countNonZero(gray != expected);
+
+        cv::Mat unflipped;
+        cv::cvtColor(bgr, unflipped, cv::COLOR_BGR2GRAY);
+        cv::Mat flipped(height, width, CV_8UC1);
+        flipGrayscale(std::span<const std::uint8_t>(unflipped.data, unflipped.total()), width, height, flipped.data, flipped.step);
+        const int flippedOnly = cv::countNonZero(flipped != expected);
+
+        if (converted != 0 || flippedOnly != 0)
+        {
+            std::cerr << "width " << width << ", " << grayscaleConversionKernel() << " kernel: " << converted
+                      << " pixels differ from cvtColor + flip, " << flippedOnly << " from flip alone" << std::endl;
+            ++failures;
+        }
+    }
+
+    if (failures == 0)
+    {
+        std::cout << "The " << grayscaleConversionKernel() << " grayscale conversion matches cvtColor + flip" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
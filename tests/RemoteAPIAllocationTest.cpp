@@ -0,0 +1,153 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+
+#include "RemoteAPIClient.h"
+#include "RemoteAPIStandIn.h"
+
+// Every heap allocation the client thread makes, libzmq's and jsoncons' included, over steady-state calls
+// and steps against the in-process stand-in (which allocates on its own thread, not counted here).
+// RemoteAPIClient::allocationCount only sees the client's own pools; this counts at the allocator
+namespace
+{
+    thread_local bool t_counting = false;
+    thread_local std::uint64_t t_allocations = 0;
+
+    void countAllocation()
+    {
+        if (t_counting)
+        {
+            ++t_allocations;
+        }
+    }
+}
+
+#if defined(__GLIBC__)
+// operator new goes through malloc in libstdc++, so hooking the C allocator also sees libzmq's blocks
+extern "C"
+{
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t count, std::size_t size);
+    void* __libc_realloc(void* p, std::size_t size);
+
+    void* malloc(const std::size_t size)
+    {
+        countAllocation();
+        return __libc_malloc(size);
+    }
+
+    void* calloc(const std::size_t count, const std::size_t size)
+    {
+        countAllocation();
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* p, const std::size_t size)
+    {
+        countAllocation();
+        return __libc_realloc(p, size);
+    }
+}
+#else
+// Elsewhere only C++ allocations are seen; libzmq's malloc calls are not
+void* operator new(const std::size_t size)
+{
+    countAllocation();
+    if (void* p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
+
+namespace
+{
+    // libzmq allocates one content block per message of more than 33 bytes it sends, and now and then a
+    // chunk of its message pipes. Nothing else may allocate per call once warmed up
+    constexpr std::uint64_t s_transportAllocationsPerCall = 1;
+    constexpr std::uint64_t s_pipeChunkSlack = 16; // one allowed per that many calls or steps
+
+    constexpr int s_warmUp = 100;
+    constexpr int s_measured = 1000;
+
+    template<class F>
+    std::uint64_t countAllocations(F&& f)
+    {
+        t_allocations = 0;
+        t_counting = true;
+        f();
+        t_counting = false;
+        return t_allocations;
+    }
+}
+
+int main()
+{
+    RemoteAPIStandInBackend backend;
+    std::unique_ptr<RemoteAPIStandIn> standIn; // outlive the client, which ends its session when destroyed
+    RemoteAPIClient client("inproc://allocation-test");
+    standIn = std::make_unique<RemoteAPIStandIn>(backend, client.context());
+    standIn->bind(client.rpcEndpoint());
+    standIn->start();
+    client.setMaxInFlight(4);
+
+    const std::int64_t body = client.call("sim.getObject", { "/Quadcopter/base" })[0].as<std::int64_t>();
+    // Built once: arguments the caller builds per call are its own allocations
+    const json positionArgs(json_array_arg, { json(body), json(-1) });
+    const json stepArgs(json_array_arg);
+
+    // Reads: pipelined calls decoded in place, as the control loop does
+    const auto reads = [&](const int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            const RemoteAPIFuture position = client.callAsync("sim.getObjectPosition", positionArgs);
+            const RemoteAPIFuture orientation = client.callAsync("sim.getObjectOrientation", positionArgs);
+            const std::array<double, 3> p = position.get<std::array<double, 3>>();
+            const std::array<double, 3> o = orientation.get<std::array<double, 3>>();
+            static_cast<void>(p[0] + o[0]);
+        }
+    };
+    reads(s_warmUp);
+    const std::uint64_t readAllocations = countAllocations([&] { reads(s_measured); });
+    const std::uint64_t readCalls = 2 * s_measured;
+    const std::uint64_t maxReadAllocations = readCalls * s_transportAllocationsPerCall + readCalls / s_pipeChunkSlack;
+    std::cout << "reads: " << readAllocations << " allocations over " << readCalls << " calls (at most "
+              << maxReadAllocations << ")" << std::endl;
+
+    // Steps: sim.step goes through its _*wait*_ round, whose reply is decoded as json; what must hold
+    // is that a step costs the same every time, so the count over many steps stays flat
+    const auto steps = [&](const int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            const RemoteAPIFuture position = client.callAsync("sim.getObjectPosition", positionArgs);
+            static_cast<void>(position.get<std::array<double, 3>>());
+            client.callAsync("sim.step", stepArgs).wait();
+        }
+    };
+    steps(s_warmUp);
+    const std::uint64_t perStep = countAllocations([&] { steps(1); });
+    const std::uint64_t stepAllocations = countAllocations([&] { steps(s_measured); });
+    const std::uint64_t maxStepAllocations = s_measured * perStep + s_measured / s_pipeChunkSlack;
+    std::cout << "steps: " << stepAllocations << " allocations over " << s_measured << " steps of "
+              << perStep << " (at most " << maxStepAllocations << "); client-tracked: "
+              << client.allocationCount() << std::endl;
+
+    return readAllocations <= maxReadAllocations && stepAllocations <= maxStepAllocations ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "RemoteAPIPool.h"
+#include "RemoteAPIStandIn.h"
+
+// RemoteAPIClientPool against the in-process stand-in: a thread's connection closes when the thread exits
+// without release(), and a thread that outlives the pool exits cleanly
+int main()
+{
+    RemoteAPIStandInBackend backend;
+    std::unique_ptr<RemoteAPIStandIn> standIn; // outlive the pool, whose primary connection ends the session
+    auto pool = std::make_unique<RemoteAPIClientPool>("inproc://pool-test");
+    standIn = std::make_unique<RemoteAPIStandIn>(backend, pool->client().context());
+    standIn->bind(pool->client().rpcEndpoint());
+    standIn->start();
+
+    int failures = 0;
+    const auto expectSize = [&](const char* when, const std::size_t expected)
+    {
+        if (pool->size() != expected)
+        {
+            std::cerr << when << ": " << pool->size() << " connections, expected " << expected << std::endl;
+            ++failures;
+        }
+    };
+
+    for (int i = 0; i < 3; ++i)
+    {
+        std::thread([&] { pool->client().call("sim.getSimulationTime"); }).join();
+    }
+    expectSize("after threads exited without release()", 1);
+
+    std::thread([&] {
+        pool->client().call("sim.getSimulationTime");
+        pool->release();
+    }).join();
+    expectSize("after a thread released and exited", 1);
+
+    // Opens its connection, then exits only once the pool is gone
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool connected = false;
+    bool poolGone = false;
+    std::thread outliving([&] {
+        pool->client().call("sim.getSimulationTime");
+        std::unique_lock<std::mutex> lock(mutex);
+        connected = true;
+        changed.notify_all();
+        changed.wait(lock, [&] { return poolGone; });
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return connected; });
+    }
+    expectSize("with a thread connected", 2);
+    pool.reset();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        poolGone = true;
+    }
+    changed.notify_all();
+    outliving.join();
+
+    if (failures == 0)
+    {
+        std::cout << "Pool connections close with their thread" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
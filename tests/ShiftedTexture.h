@@ -0,0 +1,38 @@
+#ifndef SHIFTEDTEXTURE_H
+#define SHIFTEDTEXTURE_H
+
+#include <opencv2/opencv.hpp>
+
+#include "VecMove.h"
+
+// Optical flow fixture shared by the tests and benchmarks: a blurred random texture, stretched to the full
+// gray range, of which frame() cuts VecMove's flow window after moving it by a known sub-pixel shift
+class ShiftedTexture
+{
+public:
+    explicit ShiftedTexture(const double blurSigma)
+    {
+        cv::Mat noise(4 * s_windowSize, 4 * s_windowSize, CV_8UC1);
+        cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(256));
+        cv::GaussianBlur(noise, m_texture, cv::Size(0, 0), blurSigma);
+        cv::normalize(m_texture, m_texture, 0, 255, cv::NORM_MINMAX);
+        m_window = cv::Rect(m_texture.cols / 2 - s_windowSize / 2, m_texture.rows / 2 - s_windowSize / 2, s_windowSize, s_windowSize);
+    }
+
+    // The window with the texture moved by shift, so that the flow from frame({ 0, 0 }) is shift everywhere
+    [[nodiscard]] cv::Mat frame(const cv::Point2f shift) const
+    {
+        const cv::Mat translation = (cv::Mat_<double>(2, 3) << 1, 0, shift.x, 0, 1, shift.y);
+        cv::Mat moved;
+        cv::warpAffine(m_texture, moved, translation, m_texture.size(), cv::INTER_CUBIC, cv::BORDER_REFLECT);
+        return moved(m_window).clone();
+    }
+
+    static constexpr int s_windowSize = VecMove::getFlowWindowSize();
+
+private:
+    cv::Mat m_texture;
+    cv::Rect m_window;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <opencv2/opencv.hpp>
+
+#include "OpticalFlowEngine.h"
+#include "ShiftedTexture.h"
+
+// The engines that warm-start from OpticalFlowEngine::setPrediction: with a prediction a little off the true
+// shift and a tight error bound, so that the coarse levels are skipped, the disc mean must stay where the
+// cold run puts it, on VecMove's window of a blurred random texture moved by shifts of either sign
+namespace
+{
+    constexpr const char* s_engines[] = { "farneback", "dis-fast", "lk", "patch" };
+
+    // Farneback, Lucas-Kanade and the patch converge to within 0.001 px of their cold result; DIS, whose
+    // patches all restart from the prediction, moves by up to 0.06 px
+    constexpr double s_maxDifference = 0.1;
+
+    const cv::Point2f s_predictionOffset{ 0.2f, -0.15f };
+    constexpr float s_predictionError = 0.5f;
+}
+
+int main()
+{
+    const ShiftedTexture texture(2.0);
+    const cv::Mat prev = texture.frame({ 0.0f, 0.0f });
+    const cv::Point2f centre(prev.cols * 0.5f, prev.rows * 0.5f);
+    const int radius = VecMove::getFlowDiscRadius();
+
+    int failures = 0;
+    for (const cv::Point2f shift : { cv::Point2f(0.4f, -0.3f), cv::Point2f(1.3f, -0.7f), cv::Point2f(-2.6f, 1.4f), cv::Point2f(-3.2f, -2.1f) })
+    {
+        const cv::Mat next = texture.frame(shift);
+        for (const char* name : s_engines)
+        {
+            const std::unique_ptr<OpticalFlowEngine> engine = createOpticalFlowEngine(name);
+            const cv::Point2f cold = engine->calcDiscMean(prev, next, centre, radius, false);
+
+            engine->reset();
+            engine->setPrediction(OpticalFlowEngine::Prediction{ shift + s_predictionOffset, s_predictionError });
+            const cv::Point2f warm = engine->calcDiscMean(prev, next, centre, radius, false);
+
+            const double difference = std::hypot(warm.x - cold.x, warm.y - cold.y);
+            std::cout << "shift (" << shift.x << ", " << shift.y << "), " << name << ": cold (" << cold.x << ", " << cold.y
+                      << "), predicted (" << warm.x << ", " << warm.y << "), difference " << difference << " px" << std::endl;
+            if (difference > s_maxDifference)
+            {
+                ++failures;
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}